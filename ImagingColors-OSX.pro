@@ -1,7 +1,9 @@
-QT += core gui
+QT += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
 
+CONFIG += c++14
+
 TARGET = "Imaging Colors for OSX"
 TEMPLATE = app
 
@@ -15,14 +17,17 @@ LIBS += -L/opt/local/lib \
     -lopencv_highgui \
     -lopencv_ml \
     -lopencv_video \
+    -lopencv_videoio \
     -lopencv_features2d \
     -lopencv_calib3d \
     -lopencv_objdetect \
     -lopencv_flann \
-    -lopencv_imgcodecs
+    -lopencv_imgcodecs \
+    -lz
 
 include(res/res.pri)
 include(gui/gui.pri)
 include(imaging/imaging.pri)
+include(service/service.pri)
 
 SOURCES += main.cpp
@@ -1,27 +1,35 @@
-QT += core gui
+QT += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
 
+CONFIG += c++14
+
 TARGET = "Imaging Colors for Windows 10"
 TEMPLATE = app
 
 INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\build\include"
+INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\sources\3rdparty\zlib"
+INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\sources\build\3rdparty\zlib"
 
 LIBPATH += "C:\OpenCV-3.2.0\opencv\sources\build\lib\Release"
+LIBPATH += "C:\OpenCV-3.2.0\opencv\sources\build\3rdparty\lib\Release"
 
 LIBS += -lopencv_core320 \
     -lopencv_imgproc320 \
     -lopencv_highgui320 \
     -lopencv_ml320 \
     -lopencv_video320 \
+    -lopencv_videoio320 \
     -lopencv_features2d320 \
     -lopencv_calib3d320 \
     -lopencv_objdetect320 \
     -lopencv_flann320 \
-    -lopencv_imgcodecs320
+    -lopencv_imgcodecs320 \
+    -lzlib
 
 include(res/res.pri)
 include(gui/gui.pri)
 include(imaging/imaging.pri)
+include(service/service.pri)
 
 SOURCES += main.cpp
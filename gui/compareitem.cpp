@@ -0,0 +1,134 @@
+#include "compareitem.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+// ----- Constructor / Destructor ---------------------------------------------
+CompareItem::CompareItem(const cv::Mat& inputImage, const cv::Mat& outputImage, Mode mode)
+{
+    input = inputImage;
+    output = outputImage;
+    compareMode = mode;
+    splitX = output.cols / 2.0;
+    onionWeight = 0.5;
+
+    // --- paint() needs the exposed rectangle to composite only that ---
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+CompareItem::~CompareItem()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+CompareItem::Mode CompareItem::mode() const
+{
+    return compareMode;
+}
+
+double CompareItem::split() const
+{
+    return splitX;
+}
+
+double CompareItem::onionOpacity() const
+{
+    return onionWeight;
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- Only the strip the divider crossed is repainted ---
+void CompareItem::setSplit(double x)
+{
+    x = std::max(0.0, std::min(x, static_cast<double>(output.cols)));
+    if (compareMode != SplitMode || x == splitX)
+    {
+        splitX = x;
+        return;
+    }
+
+    double left = std::min(x, splitX) - 1.0;
+    double right = std::max(x, splitX) + 1.0;
+    splitX = x;
+    update(QRectF(left, 0, right - left, output.rows));
+}
+
+void CompareItem::setOnionOpacity(double outputOpacity)
+{
+    onionWeight = std::max(0.0, std::min(outputOpacity, 1.0));
+    if (compareMode == OnionSkinMode)
+    {
+        update();
+    }
+}
+
+// ----- QGraphicsItem --------------------------------------------------------
+QRectF CompareItem::boundingRect() const
+{
+    return QRectF(0, 0, output.cols, output.rows);
+}
+
+void CompareItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+
+    QRect exposed = option->exposedRect.toAlignedRect() & QRect(0, 0, output.cols, output.rows);
+    if (exposed.isEmpty() || input.size() != output.size()
+            || input.type() != CV_8UC3 || output.type() != CV_8UC3)
+    {
+        return;
+    }
+
+    cv::Rect rect(exposed.x(), exposed.y(), exposed.width(), exposed.height());
+    cv::Mat before = input(rect);
+    cv::Mat after = output(rect);
+
+    if (buffer.width() < rect.width || buffer.height() < rect.height)
+    {
+        buffer = QImage(std::max(buffer.width(), rect.width),
+                        std::max(buffer.height(), rect.height),
+                        QImage::Format_RGB888);
+    }
+    cv::Mat dest = cv::Mat(buffer.height(), buffer.width(), CV_8UC3,
+                           buffer.bits(), buffer.bytesPerLine())(cv::Rect(0, 0, rect.width, rect.height));
+
+    switch (compareMode)
+    {
+    case SplitMode:
+    {
+        // --- Each side converts straight into the buffer, nothing is blended ---
+        int divider = std::max(0, std::min(static_cast<int>(splitX + 0.5) - rect.x, rect.width));
+        if (divider > 0)
+        {
+            cv::Mat left = dest.colRange(0, divider);
+            cv::cvtColor(before.colRange(0, divider), left, CV_BGR2RGB);
+        }
+        if (divider < rect.width)
+        {
+            cv::Mat right = dest.colRange(divider, rect.width);
+            cv::cvtColor(after.colRange(divider, rect.width), right, CV_BGR2RGB);
+        }
+        break;
+    }
+
+    case OnionSkinMode:
+        cv::addWeighted(before, 1.0 - onionWeight, after, onionWeight, 0.0, blended);
+        cv::cvtColor(blended, dest, CV_BGR2RGB);
+        break;
+
+    default:
+        cv::absdiff(after, before, blended);
+        cv::cvtColor(blended, dest, CV_BGR2RGB);
+        break;
+    }
+
+    painter->drawImage(exposed.topLeft(), buffer, QRect(0, 0, rect.width, rect.height));
+
+    if (compareMode == SplitMode)
+    {
+        painter->setPen(QPen(Qt::white, 0));
+        painter->drawLine(QPointF(splitX, exposed.top()), QPointF(splitX, exposed.top() + exposed.height()));
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef COMPAREITEM_H
+#define COMPAREITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include <opencv2/core/core.hpp>
+
+// --- Input and output composited where the view exposes them. ---
+// Holds headers of the two images, not copies, and keeps no pixmap: every
+// paint blends only the exposed pixels into a small reused buffer. Split
+// shows the input left of a movable divider, onion skin fades the output
+// over the input, difference shows |output - input| per channel.
+class CompareItem : public QGraphicsItem
+{
+public:
+    enum Mode
+    {
+        SplitMode,
+        OnionSkinMode,
+        DifferenceMode
+    };
+
+    // --- Constructor / Destructor ---
+    CompareItem(const cv::Mat& inputImage, const cv::Mat& outputImage, Mode mode);
+    ~CompareItem();
+
+    // --- Accessors ---
+    Mode mode() const;
+    double split() const;
+    double onionOpacity() const;
+
+    // --- Mutators ---
+    void setSplit(double x);
+    void setOnionOpacity(double outputOpacity);
+
+    // --- QGraphicsItem ---
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+
+private:
+    cv::Mat input;
+    cv::Mat output;
+    Mode compareMode;
+    double splitX;          // scene x of the divider
+    double onionWeight;     // onion skin weight of the output
+
+    QImage buffer;          // exposed area, reused between paints
+    cv::Mat blended;        // BGR before the swap into buffer
+};
+
+#endif // COMPAREITEM_H
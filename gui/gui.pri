@@ -2,11 +2,15 @@ INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
 SOURCES += \
+    $$PWD/compareitem.cpp \
     $$PWD/mainwindow.cpp \
+    $$PWD/pyramiditem.cpp \
     $$PWD/qcustomplot.cpp
 
 HEADERS += \
+    $$PWD/compareitem.h \
     $$PWD/mainwindow.h \
+    $$PWD/pyramiditem.h \
     $$PWD/qcustomplot.h
 
 FORMS += \
@@ -7,7 +7,16 @@ MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     inputImage(MyImage("Input Image")),
-    outputImage(MyImage("Output Image"))
+    outputImage(MyImage("Output Image")),
+    selecting(false),
+    rubberBand(0),
+    brushRadius(16),
+    previewItem(0),
+    renderMapped(false),
+    zoomFactor(1.0),
+    compareItem(0),
+    compareSplit(-1.0),
+    onionOpacity(0.5)
 {
     ui->setupUi(this);
 
@@ -18,6 +27,22 @@ MainWindow::MainWindow(QWidget *parent) :
     buildLCDs();
     buildSliderBars();
     buildGraphics();
+    buildPlots();
+
+    // --- Restore the slider state left at the end of the last session ---
+    QSettings settings;
+    exportEffort = static_cast<ExportOptions::Effort>(
+                qBound(0, settings.value("exportEffort", 1).toInt(), 2));
+    exportEffortGroup->actions().at(exportEffort)->setChecked(true);
+    connect(&exporter, SIGNAL(exported(QString,bool,qint64)),
+            this, SLOT(exportFinished(QString,bool,qint64)));
+    connect(&renderer, SIGNAL(rendered(int)), this, SLOT(outputRendered(int)));
+
+    AdjustmentPreset lastSession;
+    if (lastSession.fromJson(settings.value("lastPreset").toByteArray()))
+    {
+        restorePreset(lastSession);
+    }
 
     /*
     // --- Test ---
@@ -34,6 +59,14 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    QSettings settings;
+    settings.setValue("lastPreset", currentPreset().toJson());
+    settings.setValue("exportEffort", static_cast<int>(exportEffort));
+
+    // --- Let queued exports reach the disk, drop a half-rendered output ---
+    exporter.waitForDone();
+    renderer.cancel();
+
     delete ui;
 }
 
@@ -67,6 +100,9 @@ void MainWindow::buildMenu()
 {
     // --- New Menu Bars ---
     fileMenu = menuBar()->addMenu(tr("&File"));
+    imageMenu = menuBar()->addMenu(tr("&Image"));
+    selectMenu = menuBar()->addMenu(tr("&Select"));
+    viewMenu = menuBar()->addMenu(tr("&View"));
     helpMenu = menuBar()->addMenu(tr("&Help"));
 
     // --- New Menu Actions ---
@@ -75,8 +111,67 @@ void MainWindow::buildMenu()
     resetAction = new QAction(tr("&Reset Image"), this);
     saveAction = new QAction(tr("&Save"), this);
     saveAsAction = new QAction(tr("Save &As..."), this);
+    savePresetAction = new QAction(tr("Save &Preset..."), this);
+    loadPresetAction = new QAction(tr("&Load Preset..."), this);
+    previewEffortAction = new QAction(tr("&Preview (fastest)"), this);
+    balancedEffortAction = new QAction(tr("&Balanced"), this);
+    archivalEffortAction = new QAction(tr("&Archival (smallest)"), this);
     closeAction = new QAction(tr("&Close"), this);
     exitAction = new QAction(tr("&Exit"), this);
+    autoGrayWorldAction = new QAction(tr("Auto White Balance (&Gray World)"), this);
+    autoWhitePatchAction = new QAction(tr("Auto White Balance (&White Patch)"), this);
+    autoLevelsAction = new QAction(tr("Auto &Levels"), this);
+    applyLUT3DAction = new QAction(tr("Apply 3D &LUT (.cube)..."), this);
+    bakeLUT3DAction = new QAction(tr("&Bake Adjustments to 3D LUT..."), this);
+    linearLightAction = new QAction(tr("Linear-Light &Processing"), this);
+    linearLightAction->setCheckable(true);
+    panToolAction = new QAction(tr("&Pan"), this);
+    rectSelectAction = new QAction(tr("&Rectangle Selection"), this);
+    brushSelectAction = new QAction(tr("&Brush Selection"), this);
+    clearSelectionAction = new QAction(tr("&Clear Selection"), this);
+    featherSelectionAction = new QAction(tr("&Feather Selection..."), this);
+    brushSizeAction = new QAction(tr("Brush &Size..."), this);
+    zoomInAction = new QAction(tr("Zoom &In"), this);
+    zoomOutAction = new QAction(tr("Zoom &Out"), this);
+    actualSizeAction = new QAction(tr("&Actual Size"), this);
+    sideBySideAction = new QAction(tr("Side by &Side"), this);
+    splitCompareAction = new QAction(tr("S&plit Compare"), this);
+    onionSkinAction = new QAction(tr("O&nion Skin Compare"), this);
+    differenceAction = new QAction(tr("&Difference Compare"), this);
+    onionOpacityAction = new QAction(tr("Onion Skin Op&acity..."), this);
+
+    // --- Output view tools, Shift adds to the current selection ---
+    selectionToolGroup = new QActionGroup(this);
+    selectionToolGroup->addAction(panToolAction);
+    selectionToolGroup->addAction(rectSelectAction);
+    selectionToolGroup->addAction(brushSelectAction);
+    for (int index=0; index < selectionToolGroup->actions().size(); index++)
+    {
+        selectionToolGroup->actions().at(index)->setCheckable(true);
+    }
+    panToolAction->setChecked(true);
+
+    // --- Output view content, the compare modes in CompareItem::Mode order ---
+    compareGroup = new QActionGroup(this);
+    compareGroup->addAction(sideBySideAction);
+    compareGroup->addAction(splitCompareAction);
+    compareGroup->addAction(onionSkinAction);
+    compareGroup->addAction(differenceAction);
+    for (int index=0; index < compareGroup->actions().size(); index++)
+    {
+        compareGroup->actions().at(index)->setCheckable(true);
+    }
+    sideBySideAction->setChecked(true);
+
+    // --- Export effort, in ExportOptions::Effort order ---
+    exportEffortGroup = new QActionGroup(this);
+    exportEffortGroup->addAction(previewEffortAction);
+    exportEffortGroup->addAction(balancedEffortAction);
+    exportEffortGroup->addAction(archivalEffortAction);
+    for (int index=0; index < exportEffortGroup->actions().size(); index++)
+    {
+        exportEffortGroup->actions().at(index)->setCheckable(true);
+    }
     aboutAction = new QAction(tr("&About This Application"), this);
     aboutQtAction = new QAction(tr("&About Qt"), this);
     aboutAuthorAction = new QAction(tr("&About Author"), this);
@@ -89,6 +184,9 @@ void MainWindow::buildMenu()
     saveAsAction->setShortcut(QKeySequence::SaveAs);
     closeAction->setShortcut(QKeySequence::Close);
     exitAction->setShortcut(QKeySequence::Quit);
+    zoomInAction->setShortcut(QKeySequence::ZoomIn);
+    zoomOutAction->setShortcut(QKeySequence::ZoomOut);
+    actualSizeAction->setShortcut(QKeySequence(Qt::CTRL+Qt::Key_0));
 
     // --- Connect menu actions to slots ---
     connect(openDefaultAction, SIGNAL(triggered()), this, SLOT(openDefault()));
@@ -96,8 +194,26 @@ void MainWindow::buildMenu()
     connect(resetAction, SIGNAL(triggered()), this, SLOT(reset()));
     connect(saveAction, SIGNAL(triggered()), this, SLOT(save()));
     connect(saveAsAction, SIGNAL(triggered()), this, SLOT(saveAs()));
+    connect(savePresetAction, SIGNAL(triggered()), this, SLOT(savePreset()));
+    connect(loadPresetAction, SIGNAL(triggered()), this, SLOT(loadPreset()));
+    connect(exportEffortGroup, SIGNAL(triggered(QAction*)), this, SLOT(setExportEffort(QAction*)));
     connect(closeAction, SIGNAL(triggered()), this, SLOT(close()));
     connect(exitAction, SIGNAL(triggered()), this, SLOT(quit()));
+    connect(autoGrayWorldAction, SIGNAL(triggered()), this, SLOT(autoWhiteBalanceGrayWorld()));
+    connect(autoWhitePatchAction, SIGNAL(triggered()), this, SLOT(autoWhiteBalanceWhitePatch()));
+    connect(autoLevelsAction, SIGNAL(triggered()), this, SLOT(autoLevels()));
+    connect(applyLUT3DAction, SIGNAL(triggered()), this, SLOT(applyLUT3D()));
+    connect(bakeLUT3DAction, SIGNAL(triggered()), this, SLOT(bakeLUT3D()));
+    connect(linearLightAction, SIGNAL(toggled(bool)), this, SLOT(setLinearLight(bool)));
+    connect(selectionToolGroup, SIGNAL(triggered(QAction*)), this, SLOT(setSelectionTool(QAction*)));
+    connect(clearSelectionAction, SIGNAL(triggered()), this, SLOT(clearSelection()));
+    connect(featherSelectionAction, SIGNAL(triggered()), this, SLOT(featherSelection()));
+    connect(brushSizeAction, SIGNAL(triggered()), this, SLOT(setBrushSize()));
+    connect(zoomInAction, SIGNAL(triggered()), this, SLOT(zoomIn()));
+    connect(zoomOutAction, SIGNAL(triggered()), this, SLOT(zoomOut()));
+    connect(actualSizeAction, SIGNAL(triggered()), this, SLOT(zoomActualSize()));
+    connect(compareGroup, SIGNAL(triggered(QAction*)), this, SLOT(setCompareMode(QAction*)));
+    connect(onionOpacityAction, SIGNAL(triggered()), this, SLOT(setOnionOpacity()));
     connect(aboutAction, SIGNAL(triggered()), this, SLOT(about()));
     connect(aboutQtAction, SIGNAL(triggered()), qApp, SLOT(aboutQt()));
     connect(aboutAuthorAction, SIGNAL(triggered()), this, SLOT(aboutAuthor()));
@@ -108,8 +224,31 @@ void MainWindow::buildMenu()
     fileMenu->addAction(resetAction);
     fileMenu->addAction(saveAction);
     fileMenu->addAction(saveAsAction);
+    exportMenu = fileMenu->addMenu(tr("&Export Quality"));
+    exportMenu->addActions(exportEffortGroup->actions());
+    fileMenu->addAction(savePresetAction);
+    fileMenu->addAction(loadPresetAction);
     fileMenu->addAction(closeAction);
     fileMenu->addAction(exitAction);
+    imageMenu->addAction(autoGrayWorldAction);
+    imageMenu->addAction(autoWhitePatchAction);
+    imageMenu->addAction(autoLevelsAction);
+    imageMenu->addSeparator();
+    imageMenu->addAction(applyLUT3DAction);
+    imageMenu->addAction(bakeLUT3DAction);
+    imageMenu->addSeparator();
+    imageMenu->addAction(linearLightAction);
+    selectMenu->addActions(selectionToolGroup->actions());
+    selectMenu->addSeparator();
+    selectMenu->addAction(clearSelectionAction);
+    selectMenu->addAction(featherSelectionAction);
+    selectMenu->addAction(brushSizeAction);
+    viewMenu->addAction(zoomInAction);
+    viewMenu->addAction(zoomOutAction);
+    viewMenu->addAction(actualSizeAction);
+    viewMenu->addSeparator();
+    viewMenu->addActions(compareGroup->actions());
+    viewMenu->addAction(onionOpacityAction);
     helpMenu->addAction(aboutAction);
     helpMenu->addAction(aboutQtAction);
     helpMenu->addAction(aboutAuthorAction);
@@ -189,6 +328,45 @@ void MainWindow::buildGraphics()
 
     ui->graphicsViewInput->setDragMode(QGraphicsView::ScrollHandDrag);
     ui->graphicsViewOutput->setDragMode(QGraphicsView::ScrollHandDrag);
+
+    // --- Image items paint exactly their exposed area, no antialiasing margin ---
+    ui->graphicsViewInput->setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing);
+    ui->graphicsViewOutput->setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing);
+
+    // --- Selection tools draw on the output view, Ctrl+wheel zooms either ---
+    ui->graphicsViewInput->viewport()->installEventFilter(this);
+    ui->graphicsViewOutput->viewport()->installEventFilter(this);
+    ui->graphicsViewOutput->viewport()->setMouseTracking(true);
+
+    // --- Scrolling one view scrolls the other; equal values do not echo back ---
+    QScrollBar *inputHorizontal = ui->graphicsViewInput->horizontalScrollBar();
+    QScrollBar *inputVertical = ui->graphicsViewInput->verticalScrollBar();
+    QScrollBar *outputHorizontal = ui->graphicsViewOutput->horizontalScrollBar();
+    QScrollBar *outputVertical = ui->graphicsViewOutput->verticalScrollBar();
+
+    connect(inputHorizontal, SIGNAL(valueChanged(int)), outputHorizontal, SLOT(setValue(int)));
+    connect(outputHorizontal, SIGNAL(valueChanged(int)), inputHorizontal, SLOT(setValue(int)));
+    connect(inputVertical, SIGNAL(valueChanged(int)), outputVertical, SLOT(setValue(int)));
+    connect(outputVertical, SIGNAL(valueChanged(int)), inputVertical, SLOT(setValue(int)));
+}
+
+void MainWindow::buildPlots()
+{
+    QCustomPlot *plot = ui->plotHistogram;
+
+    // --- One graph per output channel, in the BGR order of MyImage ---
+    QList<QColor> channelColors;
+    channelColors << Qt::blue << Qt::green << Qt::red;
+
+    for (int channel=0; channel < channelColors.size(); channel++)
+    {
+        plot->addGraph();
+        plot->graph(channel)->setPen(QPen(channelColors.at(channel)));
+        plot->graph(channel)->setLineStyle(QCPGraph::lsStepCenter);
+    }
+
+    plot->xAxis->setRange(0, MyImage::histogramBins - 1);
+    plot->yAxis->setTickLabels(false);
 }
 
 // ----- File Menu Action Slots -----------------------------------------------
@@ -200,11 +378,15 @@ void MainWindow::openDefault()
     tmp = QString(":/") +  tmp; // used to define path to a resource file
     appendStatus(QString("Loading from default list ... ") + tmp);
 
+    renderer.cancel();
     inputImage.setImage(tmp, -1);
     outputImage.setImage(tmp, -1);
+    inputImage.computeStatistics();
+    selection.reset(cv::Size(inputImage.image.cols, inputImage.image.rows));
 
     updateInput();
     updateOutput();
+    updateSlidersFromImage();
 }
 
 void MainWindow::open()
@@ -219,7 +401,8 @@ void MainWindow::open()
     dialog.setViewMode(QFileDialog::Detail);
 
     dialog.setDirectory(defaultDirectory);
-    dialog.setNameFilter(tr("Image (*.png)"));
+    dialog.setNameFilters(QStringList() << tr("Image (*.png)")
+                                        << tr("Work Image (*.ict)"));
     dialog.setDefaultSuffix("png");
 
     if (dialog.exec())
@@ -229,11 +412,15 @@ void MainWindow::open()
 
         appendStatus(QString("Loading from file ... ") + filePath);
 
+        renderer.cancel();
         inputImage.setImage(filePath);
         outputImage.setImage(filePath);
+        inputImage.computeStatistics();
+        selection.reset(cv::Size(inputImage.image.cols, inputImage.image.rows));
 
         updateInput();
         updateOutput();
+        updateSlidersFromImage();
     }
     else {
         appendStatus(" ... open canceled");
@@ -253,6 +440,8 @@ void MainWindow::reset()
 
     inputScene->clear();
     outputScene->clear();
+    outputImage.histogram.clear();
+    updateHistogram();
     appendStatus(QString("Images cleared"));
 }
 
@@ -261,24 +450,27 @@ void MainWindow::save()
     menuStatus("File","Save");
 
     // --- Check if image data exists ---
-    if(false)
+    if(outputImage.image.empty())
     {
         appendStatus(QString("No data loaded, save canceled."));
         return;
     }
 
-    QString tmpName = "/_tmp.png";
-    QString filePath = defaultDirectory.path() + tmpName;
+    // --- Nothing saved yet this session, ask where to ---
+    if(lastSavePath.isEmpty())
+    {
+        saveAs();
+        return;
+    }
 
-    outputImage.saveImageToPNG(filePath);
-    appendStatus(QString("Saving to file ... ") + filePath);
+    exportOutput(lastSavePath);
 }
 
 void MainWindow::saveAs()
 {
     menuStatus("File","Save As...");
 
-    if(false)
+    if(outputImage.image.empty())
     {
         appendStatus(QString("No data loaded, save canceled."));
         return;
@@ -288,26 +480,118 @@ void MainWindow::saveAs()
     QFileDialog dialog(this);
 
     dialog.setAcceptMode(QFileDialog::AcceptSave);
-    dialog.setFileMode(QFileDialog::ExistingFile);
+    dialog.setFileMode(QFileDialog::AnyFile);
     dialog.setViewMode(QFileDialog::Detail);
 
     dialog.setDirectory(QDir::homePath() + QString("/Desktop"));
-    dialog.setNameFilter(tr("Image (*.png)"));
+    dialog.setNameFilters(QStringList() << tr("PNG Image (*.png)")
+                                        << tr("JPEG Image (*.jpg *.jpeg)")
+                                        << tr("WebP Image (*.webp)")
+                                        << tr("TIFF Image (*.tif *.tiff)")
+                                        << tr("Work Image (*.ict)"));
     dialog.setDefaultSuffix("png");
 
     if (dialog.exec())
     {
         QStringList fileList = dialog.selectedFiles();
-        QString filePath = fileList.at(0);
-        appendStatus(QString("Saving to file ... ") + filePath);
+        lastSavePath = fileList.at(0);
 
-        outputImage.saveImageToPNG(filePath);
+        exportOutput(lastSavePath);
     }
     else {
         appendStatus(" ... save canceled");
     }
 }
 
+// --- Format from the extension, encoder settings from Export Quality ---
+void MainWindow::exportOutput(QString filePath)
+{
+    ExportOptions options = ExportOptions::forEffort(exportEffort,
+                                                     ExportOptions::formatForPath(filePath));
+
+    appendStatus(QString("Saving to file ... ") + filePath + QString(" as ") + options.formatName());
+    exporter.exportImage(filePath, outputImage.image, options);
+}
+
+void MainWindow::setExportEffort(QAction *action)
+{
+    exportEffort = static_cast<ExportOptions::Effort>(exportEffortGroup->actions().indexOf(action));
+    menuStatus("File", QString("Export Quality: ") + action->text().remove('&'));
+}
+
+void MainWindow::exportFinished(QString filePath, bool succeeded, qint64 milliseconds)
+{
+    if (succeeded)
+    {
+        appendStatus(QString(" ... saved ") + filePath
+                     + QString(" in %1 ms").arg(milliseconds));
+    }
+    else
+    {
+        appendStatus(QString(" ... could not save ") + filePath);
+    }
+}
+
+void MainWindow::savePreset()
+{
+    menuStatus("File","Save Preset...");
+
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                                    tr("Save Preset"),
+                                                    defaultDirectory.path(),
+                                                    tr("Preset (*.json)"));
+    if (filePath.isEmpty())
+    {
+        appendStatus(" ... save canceled");
+        return;
+    }
+
+    AdjustmentPreset preset = currentPreset();
+    preset.name = QFileInfo(filePath).completeBaseName();
+
+    if (preset.save(filePath))
+    {
+        appendStatus(QString("Saving to file ... ") + filePath);
+    }
+    else
+    {
+        appendStatus(QString("Cannot write ") + filePath);
+    }
+}
+
+void MainWindow::loadPreset()
+{
+    menuStatus("File","Load Preset...");
+
+    QString filePath = QFileDialog::getOpenFileName(this,
+                                                    tr("Load Preset"),
+                                                    defaultDirectory.path(),
+                                                    tr("Preset (*.json *.cube)"));
+    if (filePath.isEmpty())
+    {
+        appendStatus(" ... load canceled");
+        return;
+    }
+
+    QString error;
+    AdjustmentPreset preset = AdjustmentPreset::load(filePath, &error);
+    if (!error.isEmpty())
+    {
+        appendStatus(error);
+        return;
+    }
+
+    restorePreset(preset);
+
+    if (!inputImage.image.empty())
+    {
+        CompiledPreset compiled = preset.compile();
+        outputImage.applyPreset(inputImage.image, compiled);
+        updateOutput();
+        appendStatus(QString("Applied ") + compiled.kernelName() + " ... " + filePath);
+    }
+}
+
 void MainWindow::close()
 {
     menuStatus("File","Close");
@@ -322,6 +606,384 @@ void MainWindow::quit()
     QApplication::quit();
 }
 
+// ----- Image Menu Action Slots ----------------------------------------------
+void MainWindow::autoWhiteBalanceGrayWorld()
+{
+    menuStatus("Image","Auto White Balance (Gray World)");
+
+    if(inputImage.image.empty())
+    {
+        appendStatus(QString("No data loaded."));
+        return;
+    }
+
+    outputImage.autoWhiteBalanceGrayWorld(inputImage.image);
+    updateOutput();
+}
+
+void MainWindow::autoWhiteBalanceWhitePatch()
+{
+    menuStatus("Image","Auto White Balance (White Patch)");
+
+    if(inputImage.image.empty())
+    {
+        appendStatus(QString("No data loaded."));
+        return;
+    }
+
+    outputImage.autoWhiteBalanceWhitePatch(inputImage.image);
+    updateOutput();
+}
+
+void MainWindow::autoLevels()
+{
+    menuStatus("Image","Auto Levels");
+
+    if(inputImage.image.empty())
+    {
+        appendStatus(QString("No data loaded."));
+        return;
+    }
+
+    outputImage.autoLevels(inputImage.image);
+    updateOutput();
+}
+
+void MainWindow::applyLUT3D()
+{
+    menuStatus("Image","Apply 3D LUT");
+
+    if(inputImage.image.empty())
+    {
+        appendStatus(QString("No data loaded."));
+        return;
+    }
+
+    QString filePath = QFileDialog::getOpenFileName(this,
+                                                    tr("Apply 3D LUT"),
+                                                    defaultDirectory.path(),
+                                                    tr("3D LUT (*.cube)"));
+    if (filePath.isEmpty())
+    {
+        appendStatus(" ... apply canceled");
+        return;
+    }
+
+    QString error;
+    ColorLUT3D lut = ColorLUT3D::loadCube(filePath, &error);
+
+    if (!lut.isValid())
+    {
+        appendStatus(error);
+        return;
+    }
+
+    outputImage.applyLUT3D(inputImage.image, lut);
+    updateOutput();
+    appendStatus(QString("Applied ... ") + filePath);
+}
+
+void MainWindow::bakeLUT3D()
+{
+    menuStatus("Image","Bake Adjustments to 3D LUT");
+
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                                    tr("Bake 3D LUT"),
+                                                    defaultDirectory.path(),
+                                                    tr("3D LUT (*.cube)"));
+    if (filePath.isEmpty())
+    {
+        appendStatus(" ... bake canceled");
+        return;
+    }
+
+    // --- The slider state is always realized as RGB gains ---
+    double R = 1.0 * ui->sliderRed->value() / ui->sliderRed->maximum();
+    double G = 1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum();
+    double B = 1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum();
+
+    AdjustmentChain chain;
+    chain.addGains(R, G, B);
+
+    ColorLUT3D lut = chain.bake();
+    lut.title = QString("Imaging Colors RGB [ %1, %2, %3 ]")
+            .arg(ui->sliderRed->value())
+            .arg(ui->sliderGreen->value())
+            .arg(ui->sliderBlue->value());
+
+    if (lut.saveCube(filePath))
+    {
+        appendStatus(QString("Saving to file ... ") + filePath);
+    }
+    else
+    {
+        appendStatus(QString("Cannot write ") + filePath);
+    }
+}
+
+void MainWindow::setLinearLight(bool enabled)
+{
+    menuStatus("Image","Linear-Light Processing");
+
+    outputImage.linearLight = enabled;
+    appendStatus(enabled ? QString("on") : QString("off"));
+    reapplyAdjustment();
+}
+
+// ----- Select Menu Action Slots ---------------------------------------------
+void MainWindow::setSelectionTool(QAction *action)
+{
+    menuStatus("Select", action->text().remove('&'));
+
+    ui->graphicsViewOutput->setDragMode(action == panToolAction ? QGraphicsView::ScrollHandDrag
+                                                                : QGraphicsView::NoDrag);
+}
+
+void MainWindow::clearSelection()
+{
+    menuStatus("Select","Clear Selection");
+
+    selection.clear();
+    selection.finish();
+    reapplyAdjustment();
+}
+
+void MainWindow::featherSelection()
+{
+    menuStatus("Select","Feather Selection");
+
+    bool accepted = false;
+    int radius = QInputDialog::getInt(this, tr("Feather Selection"), tr("Edge radius in pixels:"),
+                                      selection.feather(), 0, 256, 1, &accepted);
+    if (!accepted)
+    {
+        appendStatus(" ... feather canceled");
+        return;
+    }
+
+    selection.setFeather(radius);
+    selection.finish();
+    reapplyAdjustment();
+    appendStatus(QString(" ... %1 px").arg(radius));
+}
+
+void MainWindow::setBrushSize()
+{
+    menuStatus("Select","Brush Size");
+
+    bool accepted = false;
+    int radius = QInputDialog::getInt(this, tr("Brush Size"), tr("Brush radius in pixels:"),
+                                      brushRadius, 1, 512, 1, &accepted);
+    if (accepted)
+    {
+        brushRadius = radius;
+        appendStatus(QString(" ... %1 px").arg(radius));
+    }
+}
+
+// ----- View Menu Action Slots -----------------------------------------------
+void MainWindow::zoomIn()
+{
+    menuStatus("View","Zoom In");
+    applyZoom(zoomFactor * 2.0);
+    appendStatus(QString(" ... %1%").arg(100.0 * zoomFactor, 0, 'f', 0));
+}
+
+void MainWindow::zoomOut()
+{
+    menuStatus("View","Zoom Out");
+    applyZoom(zoomFactor / 2.0);
+    appendStatus(QString(" ... %1%").arg(100.0 * zoomFactor, 0, 'f', 0));
+}
+
+void MainWindow::zoomActualSize()
+{
+    menuStatus("View","Actual Size");
+    applyZoom(1.0);
+}
+
+// --- Both views get the same transform, so the locked scroll bars line up ---
+void MainWindow::applyZoom(double factor)
+{
+    zoomFactor = qBound(1.0 / 32.0, factor, 32.0);
+
+    QTransform transform = QTransform::fromScale(zoomFactor, zoomFactor);
+    ui->graphicsViewInput->setTransform(transform);
+    ui->graphicsViewOutput->setTransform(transform);
+}
+
+void MainWindow::setCompareMode(QAction *action)
+{
+    menuStatus("View", action->text().remove('&'));
+    updateOutput();
+}
+
+void MainWindow::setOnionOpacity()
+{
+    menuStatus("View","Onion Skin Opacity");
+
+    bool accepted = false;
+    int percent = QInputDialog::getInt(this, tr("Onion Skin Opacity"), tr("Output opacity in percent:"),
+                                       qRound(100.0 * onionOpacity), 0, 100, 5, &accepted);
+    if (!accepted)
+    {
+        appendStatus(" ... opacity canceled");
+        return;
+    }
+
+    onionOpacity = percent / 100.0;
+    if (compareItem)
+    {
+        compareItem->setOnionOpacity(onionOpacity);
+    }
+    appendStatus(QString(" ... %1%").arg(percent));
+}
+
+// --- Ctrl+wheel zooms both views; otherwise mouse on the output view ---
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    bool viewport = watched == ui->graphicsViewInput->viewport()
+            || watched == ui->graphicsViewOutput->viewport();
+
+    if (viewport && event->type() == QEvent::Wheel)
+    {
+        QWheelEvent *wheel = static_cast<QWheelEvent*>(event);
+        if (wheel->modifiers() & Qt::ControlModifier)
+        {
+            applyZoom(zoomFactor * pow(2.0, wheel->angleDelta().y() / 480.0));
+            return true;
+        }
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    // --- The split divider follows the pointer ---
+    if (compareItem && compareItem->mode() == CompareItem::SplitMode
+            && watched == ui->graphicsViewOutput->viewport() && event->type() == QEvent::MouseMove
+            && !selecting)
+    {
+        QMouseEvent *mouse = static_cast<QMouseEvent*>(event);
+        compareSplit = ui->graphicsViewOutput->mapToScene(mouse->pos()).x();
+        compareItem->setSplit(compareSplit);
+    }
+
+    bool mouseEvent = event->type() == QEvent::MouseButtonPress
+            || event->type() == QEvent::MouseMove
+            || event->type() == QEvent::MouseButtonRelease;
+
+    if (watched != ui->graphicsViewOutput->viewport() || !mouseEvent
+            || panToolAction->isChecked() || selection.size().area() == 0)
+    {
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    QMouseEvent *mouse = static_cast<QMouseEvent*>(event);
+    QPointF point = ui->graphicsViewOutput->mapToScene(mouse->pos());
+    cv::Point pixel(qRound(point.x()), qRound(point.y()));
+
+    if (event->type() == QEvent::MouseButtonPress && mouse->button() == Qt::LeftButton)
+    {
+        if (!(mouse->modifiers() & Qt::ShiftModifier))
+        {
+            selection.clear();
+        }
+
+        selecting = true;
+        selectionStart = point;
+        lastBrushPoint = point;
+
+        if (brushSelectAction->isChecked())
+        {
+            selection.addStroke(pixel, pixel, brushRadius);
+        }
+        else
+        {
+            rubberBand = outputScene->addRect(QRectF(point, point), QPen(Qt::yellow, 0, Qt::DashLine));
+        }
+        return true;
+    }
+
+    if (!selecting)
+    {
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    if (event->type() == QEvent::MouseMove)
+    {
+        // --- The stroke is drawn into the mask at once, shown as a plain line ---
+        if (brushSelectAction->isChecked())
+        {
+            selection.addStroke(cv::Point(qRound(lastBrushPoint.x()), qRound(lastBrushPoint.y())),
+                                pixel, brushRadius);
+            outputScene->addLine(QLineF(lastBrushPoint, point),
+                                 QPen(QBrush(QColor(255, 255, 0, 96)), 2 * brushRadius,
+                                      Qt::SolidLine, Qt::RoundCap));
+            lastBrushPoint = point;
+        }
+        else if (rubberBand)
+        {
+            rubberBand->setRect(QRectF(selectionStart, point).normalized());
+        }
+        return true;
+    }
+
+    if (event->type() == QEvent::MouseButtonRelease)
+    {
+        if (rectSelectAction->isChecked())
+        {
+            QRect rect = QRectF(selectionStart, point).normalized().toAlignedRect();
+            selection.addRect(cv::Rect(rect.x(), rect.y(), rect.width(), rect.height()));
+        }
+
+        selecting = false;
+        rubberBand = 0;     // owned by the scene, cleared with it below
+
+        selection.finish();
+        reapplyAdjustment();
+        return true;
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+// ----- Presets --------------------------------------------------------------
+// --- The sliders always resolve to RGB gains, so that is the chain saved ---
+AdjustmentPreset MainWindow::currentPreset()
+{
+    AdjustmentPreset preset;
+    preset.name = "Current Session";
+    preset.chain.setLinearLight(outputImage.linearLight);
+    preset.chain.addGains(1.0 * ui->sliderRed->value() / ui->sliderRed->maximum(),
+                          1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum(),
+                          1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum());
+
+    preset.sliders << ui->sliderRed->value()
+                   << ui->sliderGreen->value()
+                   << ui->sliderBlue->value()
+                   << ui->sliderHue->value()
+                   << ui->sliderSaturation->value()
+                   << ui->sliderIntensity->value();
+    return preset;
+}
+
+void MainWindow::restorePreset(const AdjustmentPreset& preset)
+{
+    linearLightAction->setChecked(preset.chain.isLinearLight());
+
+    if (preset.sliders.size() != AdjustmentPreset::sliderCount)
+    {
+        return;
+    }
+
+    ui->sliderRed->setValue(preset.sliders.at(0));
+    ui->sliderGreen->setValue(preset.sliders.at(1));
+    ui->sliderBlue->setValue(preset.sliders.at(2));
+    ui->sliderHue->setValue(preset.sliders.at(3));
+    ui->sliderSaturation->setValue(preset.sliders.at(4));
+    ui->sliderIntensity->setValue(preset.sliders.at(5));
+
+    colorStatus();
+}
+
 // ----- Help Menu Action Slots -----------------------------------------------
 void MainWindow::about()
 {
@@ -370,37 +1032,97 @@ void MainWindow::updateInput()
 {
     inputScene->clear();
     inputScene->setSceneRect(0, 0, inputImage.image.cols, inputImage.image.rows);
-    inputScene->addPixmap(QPixmap::fromImage(inputImage.getQImage()));
+    inputScene->addItem(new PyramidItem(inputImage.getQImage()));
 }
 
 void MainWindow::updateOutput()
 {
+    // --- Whatever changed the output wins over a frame still rendering ---
+    renderer.cancel();
+
     outputScene->clear();
+    previewItem = 0;
+    compareItem = 0;
     outputScene->setSceneRect(0, 0, outputImage.image.cols, outputImage.image.rows);
-    outputScene->addPixmap(QPixmap::fromImage(outputImage.getQImage()));
+
+    // --- Compare modes composite from the images themselves, no output pixmap ---
+    if (sideBySideAction->isChecked())
+    {
+        outputScene->addItem(new PyramidItem(outputImage.getQImage()));
+    }
+    else
+    {
+        CompareItem::Mode mode = static_cast<CompareItem::Mode>(
+                    compareGroup->actions().indexOf(compareGroup->checkedAction()) - 1);
+
+        compareItem = new CompareItem(inputImage.image, outputImage.image, mode);
+        compareItem->setOnionOpacity(onionOpacity);
+        if (compareSplit >= 0.0)
+        {
+            compareItem->setSplit(compareSplit);
+        }
+        outputScene->addItem(compareItem);
+    }
+    drawSelectionOutline();
+
+    // --- Per-channel remaps of the input need no rescan ---
+    outputImage.updateHistogram(inputImage.histogram);
+    updateHistogram();
+}
+
+void MainWindow::updateHistogram()
+{
+    QCustomPlot *plot = ui->plotHistogram;
+    double peak = 1.0;
+
+    for (int channel=0; channel < plot->graphCount(); channel++)
+    {
+        QVector<double> bins, counts;
+
+        if (channel < outputImage.histogram.size())
+        {
+            const QVector<int>& histogram = outputImage.histogram.at(channel);
+            for (int bin=0; bin < histogram.size(); bin++)
+            {
+                bins.append(bin);
+                counts.append(histogram.at(bin));
+                peak = std::max(peak, 1.0 * histogram.at(bin));
+            }
+        }
+        plot->graph(channel)->setData(bins, counts);
+    }
+
+    plot->yAxis->setRange(0, peak);
+    plot->replot();
 }
 
 void MainWindow::updateRedColor()
 {
     double tmp = 1.0 * ui->sliderRed->value() / ui->sliderRed->maximum();
-    outputImage.adjustRGB(inputImage.image, 2, tmp);
-    updateOutput();
+    if (adjustOutputRGB(tmp, 1.0, 1.0))
+    {
+        updateOutput();
+    }
     updateHSISliders();
 }
 
 void MainWindow::updateGreenColor()
 {
     double tmp = 1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum();
-    outputImage.adjustRGB(inputImage.image, 1, tmp);
-    updateOutput();
+    if (adjustOutputRGB(1.0, tmp, 1.0))
+    {
+        updateOutput();
+    }
     updateHSISliders();
 }
 
 void MainWindow::updateBlueColor()
 {
     double tmp = 1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum();
-    outputImage.adjustRGB(inputImage.image, 0, tmp);
-    updateOutput();
+    if (adjustOutputRGB(1.0, 1.0, tmp))
+    {
+        updateOutput();
+    }
     updateHSISliders();
 }
 
@@ -412,10 +1134,160 @@ void MainWindow::updateHSVColor()
     double G = 1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum();
     double B = 1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum();
 
-    outputImage.adjustRGB(inputImage.image, R, G, B);
+    if (adjustOutputRGB(R, G, B))
+    {
+        updateOutput();
+    }
+}
+
+// --- A setting already seen for this input and selection is copied back ---
+// Returns false when the output is still rendering: zoomed in on a large
+// image, the visible tiles are shown at once and outputRendered() takes over
+// when the rest of the frame is done.
+bool MainWindow::adjustOutputRGB(double redScale, double greenScale, double blueScale)
+{
+    QMap<QString, double> parameters;
+    parameters["red"] = redScale;
+    parameters["green"] = greenScale;
+    parameters["blue"] = blueScale;
+    parameters["linearLight"] = outputImage.linearLight ? 1.0 : 0.0;
+    QString key = ResultCache::canonicalParameters(parameters);
+
+    quint64 sources[2] = { inputImage.contentHash(), selection.contentHash() };
+    quint64 source = ImageHash::hash(sources, sizeof(sources));
+
+    ResultCache::Entry entry;
+    if (resultCache.lookup(source, key, entry))
+    {
+        entry.image.copyTo(outputImage.image);
+        outputImage.invalidateHash();
+        outputImage.channelLUT = entry.channelLUT.clone();
+        outputImage.channelMapped = entry.channelMapped;
+        return true;
+    }
+
+    cv::Rect visible = visibleOutputRect();
+    if (!compareItem && ViewportRenderer::isWorthwhile(inputImage.image, visible))
+    {
+        renderKey = key;
+        renderSource = source;
+        renderLUT = MyImage::buildChannelLUT(redScale, greenScale, blueScale,
+                                             outputImage.linearLight);
+        renderMapped = selection.isEmpty();
+
+        renderer.start(inputImage.image, renderLUT, selection, visible);
+        showVisibleOutput(visible);
+        return false;
+    }
+
+    outputImage.adjustRGB(inputImage.image, redScale, greenScale, blueScale, selection);
+
+    entry.image = outputImage.image;
+    entry.channelLUT = outputImage.channelLUT;
+    entry.channelMapped = outputImage.channelMapped;
+    resultCache.insert(source, key, entry);
+    return true;
+}
+
+// --- Scene area shown by the output view, in image pixels ---
+cv::Rect MainWindow::visibleOutputRect()
+{
+    QGraphicsView *view = ui->graphicsViewOutput;
+    QRect area = view->mapToScene(view->viewport()->rect()).boundingRect().toAlignedRect()
+            & QRect(0, 0, inputImage.image.cols, inputImage.image.rows);
+
+    return cv::Rect(area.x(), area.y(), area.width(), area.height());
+}
+
+// --- Lay the freshly mapped visible tiles over the stale output pixmap ---
+void MainWindow::showVisibleOutput(cv::Rect visible)
+{
+    cv::Rect image(0, 0, renderer.result().cols, renderer.result().rows);
+    visible &= image;
+
+    QImage preview(visible.width, visible.height, QImage::Format_RGB888);
+    cv::Mat dest(preview.height(), preview.width(), CV_8UC3, preview.bits(), preview.bytesPerLine());
+    cv::cvtColor(renderer.result()(visible), dest, CV_BGR2RGB);
+
+    if (previewItem)
+    {
+        outputScene->removeItem(previewItem);
+        delete previewItem;
+    }
+    previewItem = outputScene->addPixmap(QPixmap::fromImage(preview));
+    previewItem->setOffset(visible.x, visible.y);
+}
+
+// --- The background tiles are done: the frame becomes the output ---
+void MainWindow::outputRendered(int generation)
+{
+    if (generation != renderer.generation())
+    {
+        return;
+    }
+
+    outputImage.image = renderer.takeResult();
+    outputImage.invalidateHash();
+    outputImage.channelLUT = renderMapped ? renderLUT : cv::Mat();
+    outputImage.channelMapped = renderMapped;
+
+    ResultCache::Entry entry;
+    entry.image = outputImage.image;
+    entry.channelLUT = outputImage.channelLUT;
+    entry.channelMapped = outputImage.channelMapped;
+    resultCache.insert(renderSource, renderKey, entry);
+
     updateOutput();
 }
 
+// --- Run the RGB sliders again, after the selection changed ---
+void MainWindow::reapplyAdjustment()
+{
+    if (inputImage.image.empty())
+    {
+        return;
+    }
+
+    double R = 1.0 * ui->sliderRed->value() / ui->sliderRed->maximum();
+    double G = 1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum();
+    double B = 1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum();
+
+    if (adjustOutputRGB(R, G, B))
+    {
+        updateOutput();
+    }
+}
+
+// --- Dashed outline of the half-selected level, traced inside the bounds only ---
+void MainWindow::drawSelectionOutline()
+{
+    if (selection.isEmpty())
+    {
+        return;
+    }
+
+    cv::Rect bounds = selection.bounds();
+    cv::Mat inside;
+    cv::threshold(selection.weights()(bounds), inside, 127, 255, cv::THRESH_BINARY);
+
+    std::vector< std::vector<cv::Point> > contours;
+    cv::findContours(inside, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, bounds.tl());
+
+    QPainterPath path;
+    for (size_t contour=0; contour < contours.size(); contour++)
+    {
+        const std::vector<cv::Point>& points = contours.at(contour);
+        path.moveTo(points.at(0).x, points.at(0).y);
+        for (size_t index=1; index < points.size(); index++)
+        {
+            path.lineTo(points.at(index).x, points.at(index).y);
+        }
+        path.closeSubpath();
+    }
+
+    outputScene->addPath(path, QPen(Qt::yellow, 0, Qt::DashLine))->setZValue(1);
+}
+
 // ---- Color Map Slots ------------------------------------------------------
 void MainWindow::updateRedValue()
 {
@@ -455,40 +1327,13 @@ void MainWindow::updateIntensityValue()
 
 void MainWindow::updateRGBSliders()
 {
-    double PI, R, G, B, H, S, I, angle1, angle2, angle3, angle4;
+    double R, G, B, H, S, I;
 
-    PI = acos(-1);
     H = 1.0 * ui->sliderHue->value() / ui->sliderHue->maximum();
     S = 1.0 * ui->sliderSaturation->value() / ui->sliderSaturation->maximum();
     I = 1.0 * ui->sliderIntensity->value() / ui->sliderIntensity->maximum();
 
-    H *= (2.0 * PI);
-    angle1 = 0.0;
-    angle2 = (1.0/3.0) * 2.0 * PI;
-    angle3 = angle2 * 2.0;
-    angle4 = angle2 * 3.0;
-
-    if (angle1 <= H && H < angle2)
-    {
-        H -= angle1;
-        B = I * (1.0 - S);
-        R = I * (1.0 + S * cos(H) / cos(angle2 / 2.0 - H));
-        G = 3.0 * I - (R + B);
-    }
-    else if (angle2 <= H && H < angle3)
-    {
-        H -= angle2;
-        R = I * (1.0 - S);
-        G = I * (1.0 + S * cos(H) / cos(angle2 / 2.0 - H));
-        B = 3.0 * I - (R + G);
-    }
-    else
-    {
-        H -= angle3;
-        G = I * (1.0 - S);
-        B = I * (1.0 + S * cos(H) / cos(angle2 / 2.0 - H));;
-        R = 3.0 * I - (G + B);
-    }
+    MyImage::hsiToRGB(H, S, I, R, G, B);
 
     R *= 1.0 * ui->sliderRed->maximum();
     G *= 1.0 * ui->sliderGreen->maximum();
@@ -503,35 +1348,13 @@ void MainWindow::updateRGBSliders()
 
 void MainWindow::updateHSISliders()
 {
-    double PI, R, G, B, H, S, I, theta, tmpNum, tmpDen, tmpMin;
+    double R, G, B, H, S, I;
 
-    PI = acos(-1);
     R = 1.0 * ui->sliderRed->value() / ui->sliderRed->maximum();
     G = 1.0 * ui->sliderGreen->value() / ui->sliderGreen->maximum();
     B = 1.0 * ui->sliderBlue->value() / ui->sliderBlue->maximum();
 
-    tmpNum = (R - G) + (R - B);
-    tmpDen = pow((R - G), 2.0) + (R - B) * (G - B);
-    theta = acos(0.5 * tmpNum / pow(tmpDen, 0.5));
-
-    if (B > G)
-    {
-        H = 2.0 * PI - theta;
-        tmpMin = G;
-    }
-    else
-    {
-        H = theta;
-        tmpMin = B;
-    }
-    if (R < tmpMin)
-    {
-        tmpMin = R;
-    }
-
-    H /= (2.0 * PI);
-    S = 1.0 - ( 3.0 / (R + G + B)) * tmpMin;
-    I = (1.0 / 3.0) * (R + G + B);
+    MyImage::rgbToHSI(R, G, B, H, S, I);
 
     H *= 1.0 * ui->sliderHue->maximum();
     S *= 1.0 * ui->sliderSaturation->maximum();
@@ -544,4 +1367,34 @@ void MainWindow::updateHSISliders()
     colorStatus();
 }
 
+void MainWindow::updateSlidersFromImage()
+{
+    const ImageStatistics& stats = inputImage.statistics;
+
+    // --- The sliders are gains: a new image starts neutral, HSI follows RGB ---
+    ui->sliderRed->setValue(ui->sliderRed->maximum());
+    ui->sliderGreen->setValue(ui->sliderGreen->maximum());
+    ui->sliderBlue->setValue(ui->sliderBlue->maximum());
+    updateHSISliders();
+
+    if (stats.pixelCount == 0)
+    {
+        return;
+    }
 
+    // --- The statistics are reported, not loaded into the sliders ---
+    QString tmp = "Image statistics >>\tmean RGB: [ ";
+            tmp += QString::number(qRound(stats.mean[2])) + ", ";
+            tmp += QString::number(qRound(stats.mean[1])) + ", ";
+            tmp += QString::number(qRound(stats.mean[0]));
+            tmp += " ]\t>>\twhite point RGB: [ ";
+            tmp += QString::number(stats.percentileHigh[2]) + ", ";
+            tmp += QString::number(stats.percentileHigh[1]) + ", ";
+            tmp += QString::number(stats.percentileHigh[0]);
+            tmp += " ]\t>>\tmean HSI: [ ";
+            tmp += QString::number(qRound(100.0 * stats.hue)) + ", ";
+            tmp += QString::number(qRound(100.0 * stats.saturation)) + ", ";
+            tmp += QString::number(qRound(100.0 * stats.intensity));
+            tmp += " ]";
+    statusBar()->showMessage(tmp);
+}
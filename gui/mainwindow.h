@@ -9,19 +9,34 @@
 #include <QMainWindow>
 
 #include <QAction>
+#include <QActionGroup>
 #include <QDateTime>
 #include <QDir>
+#include <QEvent>
 #include <QFile>
 #include <QFileDialog>
 #include <QGraphicsItem>
+#include <QGraphicsRectItem>
 #include <QGraphicsScene>
+#include <QInputDialog>
 #include <QLCDNumber>
 #include <QList>
+#include <QMouseEvent>
+#include <QPainterPath>
+#include <QScrollBar>
+#include <QSettings>
 #include <QSlider>
 #include <QString>
 #include <QTimer>
+#include <QWheelEvent>
 
+#include "compareitem.h"
+#include "imageexporter.h"
 #include "myimage.h"
+#include "pyramiditem.h"
+#include "resultcache.h"
+#include "viewportrenderer.h"
+#include "qcustomplot.h"
 
 // --- Main Window Class ---
 namespace Ui {
@@ -36,6 +51,9 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event);
+
 private slots:
     // --- File Menu Slots ---
     void openDefault();
@@ -43,9 +61,35 @@ private slots:
     void reset();
     void save();
     void saveAs();
+    void savePreset();
+    void loadPreset();
+    void setExportEffort(QAction *action);
+    void exportFinished(QString filePath, bool succeeded, qint64 milliseconds);
+    void outputRendered(int generation);
     void close();
     void quit();
 
+    // --- Image Menu Slots ---
+    void autoWhiteBalanceGrayWorld();
+    void autoWhiteBalanceWhitePatch();
+    void autoLevels();
+    void applyLUT3D();
+    void bakeLUT3D();
+    void setLinearLight(bool enabled);
+
+    // --- Select Menu Slots ---
+    void setSelectionTool(QAction *action);
+    void clearSelection();
+    void featherSelection();
+    void setBrushSize();
+
+    // --- View Menu Slots ---
+    void zoomIn();
+    void zoomOut();
+    void zoomActualSize();
+    void setCompareMode(QAction *action);
+    void setOnionOpacity();
+
     // --- Help Menu Slots ---
     void about();
     void aboutQt();
@@ -65,10 +109,12 @@ private slots:
     void updateGreenColor();
     void updateBlueColor();
     void updateHSVColor();
+    void updateHistogram();
 
     // --- Color Map Slots ---
     void updateRGBSliders();
     void updateHSISliders();
+    void updateSlidersFromImage();
 
     void updateRedValue();
     void updateGreenValue();
@@ -87,6 +133,10 @@ private:
 
     // --- Menus ---
     QMenu *fileMenu;
+    QMenu *exportMenu;
+    QMenu *imageMenu;
+    QMenu *selectMenu;
+    QMenu *viewMenu;
     QMenu *helpMenu;
 
     // --- Actions ---
@@ -95,8 +145,36 @@ private:
     QAction *resetAction;
     QAction *saveAction;
     QAction *saveAsAction;
+    QAction *savePresetAction;
+    QAction *loadPresetAction;
+    QAction *previewEffortAction;
+    QAction *balancedEffortAction;
+    QAction *archivalEffortAction;
+    QActionGroup *exportEffortGroup;
     QAction *closeAction;
     QAction *exitAction;
+    QAction *autoGrayWorldAction;
+    QAction *autoWhitePatchAction;
+    QAction *autoLevelsAction;
+    QAction *applyLUT3DAction;
+    QAction *bakeLUT3DAction;
+    QAction *linearLightAction;
+    QAction *panToolAction;
+    QAction *rectSelectAction;
+    QAction *brushSelectAction;
+    QActionGroup *selectionToolGroup;
+    QAction *clearSelectionAction;
+    QAction *featherSelectionAction;
+    QAction *brushSizeAction;
+    QAction *zoomInAction;
+    QAction *zoomOutAction;
+    QAction *actualSizeAction;
+    QAction *sideBySideAction;
+    QAction *splitCompareAction;
+    QAction *onionSkinAction;
+    QAction *differenceAction;
+    QActionGroup *compareGroup;
+    QAction *onionOpacityAction;
     QAction *aboutAction;
     QAction *aboutQtAction;
     QAction *aboutAuthorAction;
@@ -107,21 +185,71 @@ private:
     QGraphicsScene *inputScene;
     QGraphicsScene *outputScene;
 
+    // --- Both views share one zoom; scroll bars are locked together ---
+    double zoomFactor;
+
+    // --- Output view compositing input and output, 0 when side by side ---
+    CompareItem *compareItem;
+    double compareSplit;
+    double onionOpacity;
+
     // --- Images ---
     QList<QString> imageFileList;
 
     MyImage inputImage;
     MyImage outputImage;
 
+    // --- Memoized slider results, keyed by input content ---
+    ResultCache resultCache;
+
+    // --- Selection drawn on the output view, slider edits apply inside it ---
+    SelectionMask selection;
+    bool selecting;
+    QPointF selectionStart;
+    QPointF lastBrushPoint;
+    QGraphicsRectItem *rubberBand;
+    int brushRadius;
+
+    // --- Zoomed-in slider edits, visible tiles first, see adjustOutputRGB ---
+    ViewportRenderer renderer;
+    QGraphicsPixmapItem *previewItem;
+    QString renderKey;
+    quint64 renderSource;
+    cv::Mat renderLUT;
+    bool renderMapped;
+
+    // --- Export ---
+    ImageExporter exporter;
+    ExportOptions::Effort exportEffort;
+    QString lastSavePath;
+
     // --- Build Methods ---
     void buildComboBoxes();
     void buildDirectories();
     void buildGraphics();
     void buildLCDs();
     void buildMenu();
+    void buildPlots();
     void buildResources();
     void buildSliderBars();
 
+    // --- Presets ---
+    AdjustmentPreset currentPreset();
+    void restorePreset(const AdjustmentPreset& preset);
+
+    // --- Adjustments ---
+    bool adjustOutputRGB(double redScale, double greenScale, double blueScale);
+    cv::Rect visibleOutputRect();
+    void showVisibleOutput(cv::Rect visible);
+    void reapplyAdjustment();
+    void drawSelectionOutline();
+
+    // --- View ---
+    void applyZoom(double factor);
+
+    // --- Export ---
+    void exportOutput(QString filePath);
+
 };
 
 #endif // MAINWINDOW_H
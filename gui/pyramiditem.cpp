@@ -0,0 +1,102 @@
+#include "pyramiditem.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// ----- Constructor / Destructor ---------------------------------------------
+PyramidItem::PyramidItem(const QImage& image)
+{
+    levels.push_back(image.convertToFormat(QImage::Format_RGB888));
+
+    // --- paint() needs the exposed rectangle to draw only that ---
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+PyramidItem::~PyramidItem()
+{
+    // destructor call goes here
+}
+
+// ----- Levels ---------------------------------------------------------------
+// --- Halve the previous level until index exists or the level is small ---
+const QImage& PyramidItem::level(int index)
+{
+    while (static_cast<int>(levels.size()) <= index)
+    {
+        const QImage& previous = levels.back();
+        if (std::max(previous.width(), previous.height()) <= smallestLevel)
+        {
+            break;
+        }
+
+        QImage next(std::max(1, previous.width() / 2), std::max(1, previous.height() / 2),
+                    QImage::Format_RGB888);
+        cv::Mat source(previous.height(), previous.width(), CV_8UC3,
+                       const_cast<uchar*>(previous.constBits()), previous.bytesPerLine());
+        cv::Mat dest(next.height(), next.width(), CV_8UC3, next.bits(), next.bytesPerLine());
+        cv::resize(source, dest, dest.size(), 0, 0, cv::INTER_AREA);
+
+        levels.push_back(next);
+    }
+    return levels[std::min(index, static_cast<int>(levels.size()) - 1)];
+}
+
+// --- Level width over image width: 1, 1/2, 1/4 and so on ---
+double PyramidItem::shrink(int index) const
+{
+    return static_cast<double>(levels[index].width()) / levels.front().width();
+}
+
+// ----- Accessors ------------------------------------------------------------
+// --- Screen pixels per image pixel picks the level: 1/4 zoom reads level 2 ---
+int PyramidItem::levelFor(double scale)
+{
+    int wanted = scale < 1.0 ? static_cast<int>(floor(log2(1.0 / scale))) : 0;
+    level(wanted);
+    return std::min(wanted, static_cast<int>(levels.size()) - 1);
+}
+
+// --- Level pixels covering exposedRect (image coordinates), aligned outwards ---
+QRect PyramidItem::sourceRect(int index, const QRectF& exposedRect) const
+{
+    double factor = shrink(index);
+    return QRectF(exposedRect.x() * factor, exposedRect.y() * factor,
+                  exposedRect.width() * factor, exposedRect.height() * factor).toAlignedRect()
+            & levels[index].rect();
+}
+
+// ----- QGraphicsItem --------------------------------------------------------
+QRectF PyramidItem::boundingRect() const
+{
+    return QRectF(0, 0, levels.front().width(), levels.front().height());
+}
+
+void PyramidItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+
+    QRectF exposed = option->exposedRect & boundingRect();
+    if (exposed.isEmpty())
+    {
+        return;
+    }
+
+    double scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    int index = levelFor(scale);
+    const QImage& image = levels[index];
+
+    double factor = shrink(index);
+    double onScreen = scale / factor;
+
+    // --- Level pixels covering the exposed area, the target snapped to match ---
+    QRect source = sourceRect(index, exposed);
+    QRectF target(source.x() / factor, source.y() / factor,
+                  source.width() / factor, source.height() / factor);
+
+    bool exact = fabs(onScreen - 1.0) < 1e-6;
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, !exact && onScreen < 2.0);
+    painter->drawImage(target, image, source);
+}
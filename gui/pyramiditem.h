@@ -0,0 +1,41 @@
+#ifndef PYRAMIDITEM_H
+#define PYRAMIDITEM_H
+
+#include <vector>
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+// --- Image item that paints from the level matching the view scale. ---
+// Level 0 is the image itself; each further level halves it with area
+// averaging and is built the first time a zoomed-out paint needs it. A paint
+// scales at most about twice the viewport's pixels, whatever the image size:
+// nearest neighbour when magnifying by 2 or more (crisp and cheapest),
+// bilinear in between, none at exactly one image pixel per screen pixel.
+class PyramidItem : public QGraphicsItem
+{
+public:
+    static const int smallestLevel = 64;    // longest side of the last level
+
+    // --- Constructor / Destructor ---
+    explicit PyramidItem(const QImage& image);
+    ~PyramidItem();
+
+    // --- Accessors ---
+    int levelFor(double scale);
+    QRect sourceRect(int index, const QRectF& exposedRect) const;
+
+    // --- QGraphicsItem ---
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+
+private:
+    std::vector<QImage> levels;
+
+    const QImage& level(int index);
+    double shrink(int index) const;
+};
+
+#endif // PYRAMIDITEM_H
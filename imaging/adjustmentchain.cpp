@@ -0,0 +1,235 @@
+#include "adjustmentchain.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "colortables.h"
+#include "myimage.h"
+
+namespace {
+
+// --- Sample a BGR 8-bit curve at a 0..1 value with linear interpolation ---
+float sampleCurve(const cv::Vec3b *entry, int channel, float value)
+{
+    float x = std::max(0.0f, std::min(1.0f, value)) * 255.0f;
+    int lower = std::min(static_cast<int>(x), 254);
+    float t = x - lower;
+
+    return ((1.0f - t) * entry[lower][channel] + t * entry[lower + 1][channel]) / 255.0f;
+}
+
+// --- Evaluates the chain at every node of one blue slice per task ---
+class BakeSlices : public cv::ParallelLoopBody
+{
+public:
+    BakeSlices(const AdjustmentChain& adjustmentChain, ColorLUT3D& cube)
+        : chain(adjustmentChain), lut(cube) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        float step = 1.0f / (lut.size - 1);
+
+        for (int b=range.start; b < range.end; b++)
+        {
+            for (int g=0; g < lut.size; g++)
+            {
+                for (int r=0; r < lut.size; r++)
+                {
+                    float rgb[3] = { r * step, g * step, b * step };
+                    chain.map(rgb);
+
+                    float *target = lut.node(r, g, b);
+                    target[0] = rgb[0];
+                    target[1] = rgb[1];
+                    target[2] = rgb[2];
+                }
+            }
+        }
+    }
+
+private:
+    const AdjustmentChain& chain;
+    ColorLUT3D& lut;
+};
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+AdjustmentChain::AdjustmentChain()
+{
+    linearLight = false;
+}
+
+AdjustmentChain::~AdjustmentChain()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool AdjustmentChain::isEmpty() const
+{
+    return steps.isEmpty();
+}
+
+// --- True when no step mixes channels, so a 1D table per channel suffices ---
+bool AdjustmentChain::isPerChannel() const
+{
+    for (int index=0; index < steps.size(); index++)
+    {
+        StepType type = steps.at(index).type;
+        if (type != GainStep && type != CurveStep)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AdjustmentChain::isLinearLight() const
+{
+    return linearLight;
+}
+
+int AdjustmentChain::stepCount() const
+{
+    return steps.size();
+}
+
+const AdjustmentChain::Step& AdjustmentChain::step(int index) const
+{
+    return steps.at(index);
+}
+
+// --- Run one RGB value (0..1) through every step in order, in place ---
+void AdjustmentChain::map(float rgb[3]) const
+{
+    for (int index=0; index < steps.size(); index++)
+    {
+        const Step& current = steps.at(index);
+
+        switch (current.type)
+        {
+        case GainStep:
+            for (int channel=0; channel < 3; channel++)
+            {
+                if (linearLight)
+                {
+                    float light = ColorTables::srgbToLinearFloat(rgb[channel]);
+                    rgb[channel] = ColorTables::linearToSRGBFloat(light * current.value[channel]);
+                }
+                else
+                {
+                    rgb[channel] *= current.value[channel];
+                }
+            }
+            break;
+
+        case HSIStep:
+        {
+            double H, S, I, R, G, B;
+
+            MyImage::rgbToHSI(rgb[0], rgb[1], rgb[2], H, S, I);
+            H = fmod(H + current.value[0], 1.0);
+            if (H < 0.0)
+            {
+                H += 1.0;
+            }
+            S = std::min(1.0, S * current.value[1]);
+            I *= current.value[2];
+            MyImage::hsiToRGB(H, S, I, R, G, B);
+
+            rgb[0] = R;
+            rgb[1] = G;
+            rgb[2] = B;
+            break;
+        }
+
+        case CurveStep:
+        {
+            const cv::Vec3b *entry = current.curve.ptr<cv::Vec3b>(0);
+            for (int channel=0; channel < 3; channel++)
+            {
+                rgb[channel] = sampleCurve(entry, 2 - channel, rgb[channel]);
+            }
+            break;
+        }
+
+        case LUT3DStep:
+            current.lut.lookup(rgb);
+            break;
+        }
+
+        // --- Every step works on the displayable range ---
+        for (int channel=0; channel < 3; channel++)
+        {
+            rgb[channel] = std::max(0.0f, std::min(1.0f, rgb[channel]));
+        }
+    }
+}
+
+// --- Collapse the whole chain into one table, nodes evaluated in parallel ---
+ColorLUT3D AdjustmentChain::bake(int points) const
+{
+    if (steps.size() == 1 && steps.at(0).type == LUT3DStep)
+    {
+        return steps.at(0).lut;
+    }
+
+    ColorLUT3D result(points);
+    cv::parallel_for_(cv::Range(0, points), BakeSlices(*this, result));
+    return result;
+}
+
+// ----- Mutators -------------------------------------------------------------
+void AdjustmentChain::clear()
+{
+    steps.clear();
+}
+
+void AdjustmentChain::setLinearLight(bool enabled)
+{
+    linearLight = enabled;
+}
+
+void AdjustmentChain::addGains(double redScale, double greenScale, double blueScale)
+{
+    Step newStep;
+    newStep.type = GainStep;
+    newStep.value[0] = redScale;
+    newStep.value[1] = greenScale;
+    newStep.value[2] = blueScale;
+    steps.append(newStep);
+}
+
+void AdjustmentChain::addHSI(double hueShift, double saturationScale, double intensityScale)
+{
+    Step newStep;
+    newStep.type = HSIStep;
+    newStep.value[0] = hueShift;
+    newStep.value[1] = saturationScale;
+    newStep.value[2] = intensityScale;
+    steps.append(newStep);
+}
+
+void AdjustmentChain::addCurve(const cv::Mat& channelLUT)
+{
+    CV_Assert(channelLUT.type() == CV_8UC3 && channelLUT.total() == 256);
+
+    Step newStep;
+    newStep.type = CurveStep;
+    newStep.value[0] = newStep.value[1] = newStep.value[2] = 0.0;
+    newStep.curve = channelLUT.clone();
+    steps.append(newStep);
+}
+
+void AdjustmentChain::addLUT3D(const ColorLUT3D& lut, QString source)
+{
+    CV_Assert(lut.isValid());
+
+    Step newStep;
+    newStep.type = LUT3DStep;
+    newStep.value[0] = newStep.value[1] = newStep.value[2] = 0.0;
+    newStep.lut = lut;
+    newStep.source = source;
+    steps.append(newStep);
+}
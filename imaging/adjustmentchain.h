@@ -0,0 +1,59 @@
+#ifndef ADJUSTMENTCHAIN_H
+#define ADJUSTMENTCHAIN_H
+
+#include <QString>
+#include <QVector>
+
+#include <opencv2/core/core.hpp>
+
+#include "colorlut3d.h"
+
+// --- Ordered list of pure color-to-color operations, baked to one 3D LUT ---
+class AdjustmentChain
+{
+public:
+    enum StepType
+    {
+        GainStep,       // per-channel RGB multipliers
+        HSIStep,        // hue rotation, saturation and intensity scale
+        CurveStep,      // 1x256 CV_8UC3 per-channel table, BGR like MyImage
+        LUT3DStep       // arbitrary cross-channel table
+    };
+
+    struct Step
+    {
+        StepType type;
+        double value[3];
+        cv::Mat curve;
+        ColorLUT3D lut;
+        QString source;     // .cube path of a LUT3DStep, if it came from one
+    };
+
+    // --- Constructor / Destructor ---
+    AdjustmentChain();
+    ~AdjustmentChain();
+
+    // --- Accessors ---
+    bool isEmpty() const;
+    bool isPerChannel() const;
+    bool isLinearLight() const;
+    int stepCount() const;
+    const Step& step(int index) const;
+
+    void map(float rgb[3]) const;
+    ColorLUT3D bake(int points = 33) const;
+
+    // --- Mutators ---
+    void clear();
+    void setLinearLight(bool enabled);
+    void addGains(double redScale, double greenScale, double blueScale);
+    void addHSI(double hueShift, double saturationScale, double intensityScale);
+    void addCurve(const cv::Mat& channelLUT);
+    void addLUT3D(const ColorLUT3D& lut, QString source = QString());
+
+private:
+    QVector<Step> steps;
+    bool linearLight;   // gain steps scale linear light, as MyImage::linearLight
+};
+
+#endif // ADJUSTMENTCHAIN_H
@@ -0,0 +1,350 @@
+#include "adjustmentpreset.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "myimage.h"
+
+namespace {
+
+const int presetVersion = 1;
+
+QJsonArray curveToJson(const cv::Mat& curve, int channel)
+{
+    QJsonArray values;
+    const cv::Vec3b *entry = curve.ptr<cv::Vec3b>(0);
+
+    for (int value=0; value < 256; value++)
+    {
+        values.append(entry[value][channel]);
+    }
+    return values;
+}
+
+}
+
+// ----- Compiled Preset ------------------------------------------------------
+CompiledPreset::CompiledPreset()
+{
+    kernel = IdentityKernel;
+}
+
+CompiledPreset::~CompiledPreset()
+{
+    // destructor call goes here
+}
+
+QString CompiledPreset::kernelName() const
+{
+    switch (kernel)
+    {
+    case ChannelKernel:
+        return QString("per-channel table");
+    case Table3DKernel:
+        return QString("3D LUT (%1 points)").arg(lut.size);
+    default:
+        return QString("identity");
+    }
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+AdjustmentPreset::AdjustmentPreset()
+{
+}
+
+AdjustmentPreset::~AdjustmentPreset()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+QByteArray AdjustmentPreset::toJson() const
+{
+    QJsonObject root;
+    root["version"] = presetVersion;
+    root["name"] = name;
+    root["linearLight"] = chain.isLinearLight();
+
+    if (sliders.size() == sliderCount)
+    {
+        QJsonArray values;
+        for (int index=0; index < sliders.size(); index++)
+        {
+            values.append(sliders.at(index));
+        }
+        root["sliders"] = values;
+    }
+
+    QJsonArray steps;
+    for (int index=0; index < chain.stepCount(); index++)
+    {
+        const AdjustmentChain::Step& step = chain.step(index);
+        QJsonObject object;
+
+        switch (step.type)
+        {
+        case AdjustmentChain::GainStep:
+            object["type"] = QString("gains");
+            object["red"] = step.value[0];
+            object["green"] = step.value[1];
+            object["blue"] = step.value[2];
+            break;
+
+        case AdjustmentChain::HSIStep:
+            object["type"] = QString("hsi");
+            object["hue"] = step.value[0];
+            object["saturation"] = step.value[1];
+            object["intensity"] = step.value[2];
+            break;
+
+        case AdjustmentChain::CurveStep:
+            object["type"] = QString("curve");
+            object["red"] = curveToJson(step.curve, 2);
+            object["green"] = curveToJson(step.curve, 1);
+            object["blue"] = curveToJson(step.curve, 0);
+            break;
+
+        case AdjustmentChain::LUT3DStep:
+            object["type"] = QString("lut3d");
+            if (!step.source.isEmpty())
+            {
+                object["file"] = step.source;
+            }
+            else
+            {
+                // --- Tables without a file are embedded, RGB per node ---
+                QJsonArray table;
+                for (size_t node=0; node < step.lut.table.size(); node += ColorLUT3D::tableStride)
+                {
+                    table.append(step.lut.table[node]);
+                    table.append(step.lut.table[node + 1]);
+                    table.append(step.lut.table[node + 2]);
+                }
+                object["size"] = step.lut.size;
+                object["table"] = table;
+            }
+            break;
+        }
+        steps.append(object);
+    }
+    root["steps"] = steps;
+
+    return QJsonDocument(root).toJson();
+}
+
+bool AdjustmentPreset::save(QString filePath) const
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    return file.write(toJson()) > 0;
+}
+
+// --- Pick the fastest kernel once, so applying to N images re-derives nothing ---
+CompiledPreset AdjustmentPreset::compile(int points) const
+{
+    CompiledPreset result;
+
+    if (chain.isEmpty())
+    {
+        return result;
+    }
+
+    if (!chain.isPerChannel())
+    {
+        result.kernel = CompiledPreset::Table3DKernel;
+        result.lut = chain.bake(points);
+        return result;
+    }
+
+    result.kernel = CompiledPreset::ChannelKernel;
+
+    // --- Gains alone build the GUI's own table, so both paths give equal codes ---
+    double gains[3] = { 1.0, 1.0, 1.0 };
+    bool gainsOnly = true;
+    for (int index=0; index < chain.stepCount() && gainsOnly; index++)
+    {
+        const AdjustmentChain::Step& step = chain.step(index);
+        gainsOnly = step.type == AdjustmentChain::GainStep;
+        for (int channel=0; channel < 3 && gainsOnly; channel++)
+        {
+            gains[channel] *= step.value[channel];
+        }
+    }
+    if (gainsOnly)
+    {
+        result.channelLUT = MyImage::buildChannelLUT(gains[0], gains[1], gains[2],
+                                                     chain.isLinearLight());
+        return result;
+    }
+
+    // --- Gains and curves fuse into one table per channel ---
+    result.channelLUT.create(1, 256, CV_8UC3);
+
+    cv::Vec3b *entry = result.channelLUT.ptr<cv::Vec3b>(0);
+    for (int value=0; value < 256; value++)
+    {
+        float rgb[3] = { value / 255.0f, value / 255.0f, value / 255.0f };
+        chain.map(rgb);
+
+        entry[value][0] = cv::saturate_cast<uchar>(255.0f * rgb[2]);
+        entry[value][1] = cv::saturate_cast<uchar>(255.0f * rgb[1]);
+        entry[value][2] = cv::saturate_cast<uchar>(255.0f * rgb[0]);
+    }
+    return result;
+}
+
+// ----- Mutators -------------------------------------------------------------
+bool AdjustmentPreset::fromJson(const QByteArray& json,
+                                QString *errorString,
+                                QString basePath)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+
+    if (!document.isObject())
+    {
+        if (errorString) *errorString = parseError.errorString();
+        return false;
+    }
+
+    QJsonObject root = document.object();
+    if (root["version"].toInt() > presetVersion)
+    {
+        if (errorString) *errorString = QString("Preset version is newer than this build");
+        return false;
+    }
+
+    name = root["name"].toString();
+    chain.clear();
+    chain.setLinearLight(root["linearLight"].toBool());
+
+    sliders.clear();
+    QJsonArray sliderValues = root["sliders"].toArray();
+    if (sliderValues.size() == sliderCount)
+    {
+        for (int index=0; index < sliderCount; index++)
+        {
+            sliders.append(sliderValues.at(index).toInt());
+        }
+    }
+
+    QJsonArray steps = root["steps"].toArray();
+    for (int index=0; index < steps.size(); index++)
+    {
+        QJsonObject object = steps.at(index).toObject();
+        QString type = object["type"].toString();
+
+        if (type == "gains")
+        {
+            chain.addGains(object["red"].toDouble(1.0),
+                           object["green"].toDouble(1.0),
+                           object["blue"].toDouble(1.0));
+        }
+        else if (type == "hsi")
+        {
+            chain.addHSI(object["hue"].toDouble(0.0),
+                         object["saturation"].toDouble(1.0),
+                         object["intensity"].toDouble(1.0));
+        }
+        else if (type == "curve")
+        {
+            QJsonArray channels[3] = { object["blue"].toArray(),
+                                       object["green"].toArray(),
+                                       object["red"].toArray() };
+            cv::Mat curve(1, 256, CV_8UC3);
+            cv::Vec3b *entry = curve.ptr<cv::Vec3b>(0);
+
+            for (int channel=0; channel < 3; channel++)
+            {
+                if (channels[channel].size() != 256)
+                {
+                    if (errorString) *errorString = QString("Curves need 256 values per channel");
+                    return false;
+                }
+                for (int value=0; value < 256; value++)
+                {
+                    entry[value][channel] = cv::saturate_cast<uchar>(channels[channel].at(value).toInt());
+                }
+            }
+            chain.addCurve(curve);
+        }
+        else if (type == "lut3d" && object.contains("file"))
+        {
+            QString filePath = QDir(basePath).absoluteFilePath(object["file"].toString());
+            ColorLUT3D lut = ColorLUT3D::loadCube(filePath, errorString);
+
+            if (!lut.isValid())
+            {
+                return false;
+            }
+            chain.addLUT3D(lut, object["file"].toString());
+        }
+        else if (type == "lut3d")
+        {
+            int points = object["size"].toInt();
+            QJsonArray table = object["table"].toArray();
+
+            if (points < 2 || table.size() != 3 * points * points * points)
+            {
+                if (errorString) *errorString = QString("Embedded 3D LUT has the wrong size");
+                return false;
+            }
+
+            ColorLUT3D lut(points);
+            for (int node=0; node < points * points * points; node++)
+            {
+                for (int axis=0; axis < 3; axis++)
+                {
+                    lut.table[ColorLUT3D::tableStride * node + axis] = table.at(3 * node + axis).toDouble();
+                }
+            }
+            chain.addLUT3D(lut);
+        }
+        else
+        {
+            if (errorString) *errorString = QString("Unknown preset step: ") + type;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----- Factories ------------------------------------------------------------
+// --- .cube files load as a one-step preset, anything else is JSON ---
+AdjustmentPreset AdjustmentPreset::load(QString filePath, QString *errorString)
+{
+    AdjustmentPreset result;
+    QFileInfo info(filePath);
+
+    if (info.suffix().toLower() == "cube")
+    {
+        ColorLUT3D lut = ColorLUT3D::loadCube(filePath, errorString);
+        if (lut.isValid())
+        {
+            result.name = info.completeBaseName();
+            result.chain.addLUT3D(lut, info.absoluteFilePath());
+        }
+        return result;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorString) *errorString = QString("Cannot open ") + filePath;
+        return result;
+    }
+
+    if (!result.fromJson(file.readAll(), errorString, info.absolutePath()))
+    {
+        return AdjustmentPreset();
+    }
+    return result;
+}
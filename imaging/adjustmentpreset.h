@@ -0,0 +1,66 @@
+#ifndef ADJUSTMENTPRESET_H
+#define ADJUSTMENTPRESET_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <opencv2/core/core.hpp>
+
+#include "adjustmentchain.h"
+#include "colorlut3d.h"
+
+// --- Result of compiling a preset: the cheapest kernel that reproduces it ---
+class CompiledPreset
+{
+public:
+    enum Kernel
+    {
+        IdentityKernel,     // nothing to do
+        ChannelKernel,      // one fused 1x256 CV_8UC3 table, BGR like MyImage
+        Table3DKernel       // one tetrahedral 3D LUT
+    };
+
+    // --- Constructor / Destructor ---
+    CompiledPreset();
+    ~CompiledPreset();
+
+    // --- Members ---
+    Kernel kernel;
+    cv::Mat channelLUT;
+    ColorLUT3D lut;
+
+    // --- Accessors ---
+    QString kernelName() const;
+};
+
+// --- Serializable description of an adjustment chain plus the GUI state ---
+class AdjustmentPreset
+{
+public:
+    // --- Constructor / Destructor ---
+    AdjustmentPreset();
+    ~AdjustmentPreset();
+
+    // --- Members ---
+    static const int sliderCount = 6;
+
+    QString name;
+    AdjustmentChain chain;
+    QVector<int> sliders;   // red, green, blue, hue, saturation, intensity
+
+    // --- Accessors ---
+    QByteArray toJson() const;
+    bool save(QString filePath) const;
+    CompiledPreset compile(int points = 33) const;
+
+    // --- Mutators ---
+    bool fromJson(const QByteArray& json,
+                  QString *errorString = 0,
+                  QString basePath = QString());
+
+    // --- Factories ---
+    static AdjustmentPreset load(QString filePath, QString *errorString = 0);
+};
+
+#endif // ADJUSTMENTPRESET_H
@@ -0,0 +1,303 @@
+#include "batchpipeline.h"
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "imageexporter.h"
+#include "myimage.h"
+
+namespace {
+
+// --- Runs one stage loop on its own thread ---
+class StageThread : public QThread
+{
+public:
+    explicit StageThread(std::function<void()> stageLoop) : body(stageLoop) {}
+
+protected:
+    void run()
+    {
+        body();
+    }
+
+private:
+    std::function<void()> body;
+};
+
+}
+
+// ----- Settings -------------------------------------------------------------
+BatchPipeline::Settings::Settings()
+{
+    int cores = std::max(1, QThread::idealThreadCount());
+
+    decodeThreads = 1;
+    processThreads = std::max(1, cores / 4);
+    encodeThreads = std::max(1, cores - processThreads - decodeThreads);
+    queueDepth = 4;
+    pngCompression = 3;
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+BatchPipeline::BatchPipeline(const CompiledPreset& preset, const Settings& settings) :
+    compiled(preset),
+    config(settings),
+    submittedQueue(settings.queueDepth),
+    decodedQueue(settings.queueDepth),
+    processedQueue(settings.queueDepth)
+{
+    counters.submitted = 0;
+    counters.succeeded = 0;
+    counters.failed = 0;
+    counters.decodeNanoseconds = 0;
+    counters.processNanoseconds = 0;
+    counters.encodeNanoseconds = 0;
+    counters.wallNanoseconds = 0;
+}
+
+BatchPipeline::~BatchPipeline()
+{
+    finish();
+}
+
+// ----- Accessors ------------------------------------------------------------
+BatchPipeline::Statistics BatchPipeline::statistics() const
+{
+    QMutexLocker locker(&statisticsMutex);
+    return counters;
+}
+
+// --- Per-image cost of each stage divided by its threads: the largest wins ---
+QString BatchPipeline::report() const
+{
+    Statistics stats = statistics();
+    int images = std::max(1, stats.succeeded + stats.failed);
+
+    double decode = 1e-6 * stats.decodeNanoseconds / images;
+    double process = 1e-6 * stats.processNanoseconds / images;
+    double encode = 1e-6 * stats.encodeNanoseconds / images;
+    double wall = 1e-9 * stats.wallNanoseconds;
+
+    double perDecode = decode / std::max(1, config.decodeThreads);
+    double perProcess = process / std::max(1, config.processThreads);
+    double perEncode = encode / std::max(1, config.encodeThreads);
+
+    QString slowest = "encode";
+    if (perDecode >= perProcess && perDecode >= perEncode) slowest = "decode";
+    else if (perProcess >= perEncode) slowest = "process";
+
+    return QString("%1 images (%2 failed) in %3 s, %4 images/s\n"
+                   "  decode  %5 ms/image x %6 threads\n"
+                   "  process %7 ms/image x %8 threads\n"
+                   "  encode  %9 ms/image x %10 threads\n"
+                   "  bottleneck: %11")
+            .arg(stats.succeeded + stats.failed)
+            .arg(stats.failed)
+            .arg(wall, 0, 'f', 2)
+            .arg(wall > 0.0 ? (stats.succeeded + stats.failed) / wall : 0.0, 0, 'f', 1)
+            .arg(decode, 0, 'f', 1).arg(config.decodeThreads)
+            .arg(process, 0, 'f', 1).arg(config.processThreads)
+            .arg(encode, 0, 'f', 1).arg(config.encodeThreads)
+            .arg(slowest);
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- Called on an encode thread once per image, in completion order ---
+void BatchPipeline::setFinishedCallback(std::function<void(const BatchJob&)> callback)
+{
+    onFinished = callback;
+}
+
+void BatchPipeline::start()
+{
+    if (!workers.isEmpty())
+    {
+        return;
+    }
+
+    wallClock.start();
+    decodersLeft.store(std::max(1, config.decodeThreads));
+    processorsLeft.store(std::max(1, config.processThreads));
+
+    for (int index=0; index < std::max(1, config.decodeThreads); index++)
+    {
+        workers.append(new StageThread([this]() { decodeLoop(); }));
+    }
+    for (int index=0; index < std::max(1, config.processThreads); index++)
+    {
+        workers.append(new StageThread([this]() { processLoop(); }));
+    }
+    for (int index=0; index < std::max(1, config.encodeThreads); index++)
+    {
+        workers.append(new StageThread([this]() { encodeLoop(); }));
+    }
+
+    for (int index=0; index < workers.size(); index++)
+    {
+        workers.at(index)->start();
+    }
+}
+
+// --- Blocks while the decode stage is saturated ---
+bool BatchPipeline::submit(QString inputPath, QString outputPath)
+{
+    BatchJob job;
+    job.inputPath = inputPath;
+    job.outputPath = outputPath;
+    job.succeeded = false;
+
+    if (!submittedQueue.push(job))
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&statisticsMutex);
+    counters.submitted++;
+    return true;
+}
+
+// --- Never blocks, for callers on an event loop ---
+bool BatchPipeline::trySubmit(QString inputPath, QString outputPath)
+{
+    BatchJob job;
+    job.inputPath = inputPath;
+    job.outputPath = outputPath;
+    job.succeeded = false;
+
+    if (!submittedQueue.tryPush(job))
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&statisticsMutex);
+    counters.submitted++;
+    return true;
+}
+
+// --- Drain every stage and join the threads ---
+void BatchPipeline::finish()
+{
+    if (workers.isEmpty())
+    {
+        return;
+    }
+
+    submittedQueue.close();
+    for (int index=0; index < workers.size(); index++)
+    {
+        workers.at(index)->wait();
+        delete workers.at(index);
+    }
+    workers.clear();
+
+    QMutexLocker locker(&statisticsMutex);
+    counters.wallNanoseconds = wallClock.nsecsElapsed();
+}
+
+BatchPipeline::Statistics BatchPipeline::run(const QList< QPair<QString, QString> >& jobs)
+{
+    start();
+    for (int index=0; index < jobs.size(); index++)
+    {
+        submit(jobs.at(index).first, jobs.at(index).second);
+    }
+    finish();
+
+    return statistics();
+}
+
+// ----- Stage Loops ----------------------------------------------------------
+void BatchPipeline::decodeLoop()
+{
+    BatchJob job;
+    while (submittedQueue.pop(job))
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        // --- A fresh MyImage per job, its pooled buffer travels with the job ---
+        MyImage decoder("Batch Decode");
+        decoder.setImage(job.inputPath);
+        job.image = decoder.image;
+        job.succeeded = !job.image.empty() && job.image.type() == CV_8UC3;
+
+        addTime(&Statistics::decodeNanoseconds, timer.nsecsElapsed());
+        if (!decodedQueue.push(job))
+        {
+            break;
+        }
+    }
+
+    if (decodersLeft.fetchAndAddOrdered(-1) == 1)
+    {
+        decodedQueue.close();
+    }
+}
+
+void BatchPipeline::processLoop()
+{
+    BatchJob job;
+    while (decodedQueue.pop(job))
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (job.succeeded)
+        {
+            MyImage processor("Batch Process");
+            processor.image = job.image;
+            processor.applyPreset(processor.image, compiled);
+            job.image = processor.image;
+        }
+
+        addTime(&Statistics::processNanoseconds, timer.nsecsElapsed());
+        if (!processedQueue.push(job))
+        {
+            break;
+        }
+    }
+
+    if (processorsLeft.fetchAndAddOrdered(-1) == 1)
+    {
+        processedQueue.close();
+    }
+}
+
+void BatchPipeline::encodeLoop()
+{
+    ExportOptions options;
+    options.pngCompression = config.pngCompression;
+
+    BatchJob job;
+    while (processedQueue.pop(job))
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (job.succeeded)
+        {
+            options.format = ExportOptions::formatForPath(job.outputPath);
+            job.succeeded = ImageExporter::write(job.outputPath, job.image, options);
+        }
+        job.image.release();
+
+        addTime(&Statistics::encodeNanoseconds, timer.nsecsElapsed());
+        {
+            QMutexLocker locker(&statisticsMutex);
+            if (job.succeeded) counters.succeeded++;
+            else counters.failed++;
+        }
+
+        if (onFinished)
+        {
+            onFinished(job);
+        }
+    }
+}
+
+void BatchPipeline::addTime(qint64 Statistics::*field, qint64 nanoseconds)
+{
+    QMutexLocker locker(&statisticsMutex);
+    counters.*field += nanoseconds;
+}
@@ -0,0 +1,98 @@
+#ifndef BATCHPIPELINE_H
+#define BATCHPIPELINE_H
+
+#include <functional>
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QThread>
+
+#include <opencv2/core/core.hpp>
+
+#include "adjustmentpreset.h"
+#include "boundedqueue.h"
+
+// --- One image moving through the pipeline ---
+struct BatchJob
+{
+    QString inputPath;
+    QString outputPath;
+    cv::Mat image;
+    bool succeeded;
+};
+
+// --- Three-stage decode / process / encode pipeline. ---
+// Each stage has its own thread count and the stages are joined by bounded
+// queues, so while one image is being compressed the next is being adjusted
+// and a third is being read. Throughput is set by the slowest stage alone;
+// give that stage (usually PNG encoding) the most threads.
+class BatchPipeline
+{
+public:
+    struct Settings
+    {
+        int decodeThreads;
+        int processThreads;
+        int encodeThreads;
+        int queueDepth;         // images waiting between two stages
+        int pngCompression;     // 0..9, as in MyImage::saveImageToPNG
+
+        Settings();
+    };
+
+    struct Statistics
+    {
+        int submitted;
+        int succeeded;
+        int failed;
+        qint64 decodeNanoseconds;   // summed over the stage's threads
+        qint64 processNanoseconds;
+        qint64 encodeNanoseconds;
+        qint64 wallNanoseconds;
+    };
+
+    // --- Constructor / Destructor ---
+    BatchPipeline(const CompiledPreset& preset, const Settings& settings = Settings());
+    ~BatchPipeline();
+
+    // --- Accessors ---
+    Statistics statistics() const;
+    QString report() const;
+
+    // --- Mutators ---
+    void setFinishedCallback(std::function<void(const BatchJob&)> callback);
+    void start();
+    bool submit(QString inputPath, QString outputPath);
+    bool trySubmit(QString inputPath, QString outputPath);
+    void finish();
+
+    Statistics run(const QList< QPair<QString, QString> >& jobs);
+
+private:
+    CompiledPreset compiled;
+    Settings config;
+    std::function<void(const BatchJob&)> onFinished;
+
+    BoundedQueue<BatchJob> submittedQueue;
+    BoundedQueue<BatchJob> decodedQueue;
+    BoundedQueue<BatchJob> processedQueue;
+
+    QList<QThread*> workers;
+    QAtomicInt decodersLeft;
+    QAtomicInt processorsLeft;
+
+    mutable QMutex statisticsMutex;
+    Statistics counters;
+    QElapsedTimer wallClock;
+
+    void decodeLoop();
+    void processLoop();
+    void encodeLoop();
+    void addTime(qint64 Statistics::*field, qint64 nanoseconds);
+};
+
+#endif // BATCHPIPELINE_H
@@ -0,0 +1,91 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+// --- Fixed-capacity blocking queue connecting two pipeline stages. ---
+// push() blocks while the queue is full, which is what gives the pipeline its
+// backpressure: a slow stage stalls the stages feeding it instead of letting
+// decoded frames pile up in memory.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int maximumSize)
+        : capacity(maximumSize > 0 ? maximumSize : 1), closed(false) {}
+
+    // --- Blocks while full; false if the queue was closed ---
+    bool push(const T& item)
+    {
+        QMutexLocker locker(&mutex);
+        while (items.size() >= capacity && !closed)
+        {
+            notFull.wait(&mutex);
+        }
+        if (closed)
+        {
+            return false;
+        }
+        items.enqueue(item);
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    // --- Never blocks; false if full or closed ---
+    bool tryPush(const T& item)
+    {
+        QMutexLocker locker(&mutex);
+        if (closed || items.size() >= capacity)
+        {
+            return false;
+        }
+        items.enqueue(item);
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    // --- Blocks while empty; false once closed and drained ---
+    bool pop(T& item)
+    {
+        QMutexLocker locker(&mutex);
+        while (items.isEmpty() && !closed)
+        {
+            notEmpty.wait(&mutex);
+        }
+        if (items.isEmpty())
+        {
+            return false;
+        }
+        item = items.dequeue();
+        notFull.wakeOne();
+        return true;
+    }
+
+    // --- No more pushes; consumers drain what is left, then stop ---
+    void close()
+    {
+        QMutexLocker locker(&mutex);
+        closed = true;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+    int size() const
+    {
+        QMutexLocker locker(&mutex);
+        return items.size();
+    }
+
+private:
+    int capacity;
+    bool closed;
+    QQueue<T> items;
+    mutable QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,187 @@
+#include "bufferpool.h"
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+// ----- Constructor / Destructor ---------------------------------------------
+BufferPool::BufferPool(size_t minimumBytes, size_t retainedLimitBytes)
+{
+    minimumPooledBytes = minimumBytes;
+    retainedLimit = retainedLimitBytes;
+
+    counters.hits = 0;
+    counters.misses = 0;
+    counters.bytesRetained = 0;
+    counters.bytesInUse = 0;
+}
+
+BufferPool::~BufferPool()
+{
+    trim();
+}
+
+// --- Shared pool used by MyImage and the rest of the imaging module ---
+BufferPool* BufferPool::instance()
+{
+    static BufferPool pool;
+    return &pool;
+}
+
+// ----- Accessors ------------------------------------------------------------
+BufferPool::Statistics BufferPool::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+// --- Round up to one of eight steps per power of two, at most 12.5% waste ---
+size_t BufferPool::bucketSize(size_t bytes)
+{
+    size_t power = 1;
+    while (power <= bytes / 2)
+    {
+        power *= 2;
+    }
+
+    size_t step = std::max<size_t>(power / 8, 64);
+    return ((bytes + step - 1) / step) * step;
+}
+
+// ----- Explicit API ---------------------------------------------------------
+cv::Mat BufferPool::acquire(int rows, int cols, int type)
+{
+    cv::Mat result;
+    result.allocator = this;
+    result.create(rows, cols, type);
+    return result;
+}
+
+// --- Route every later create() on this Mat through the shared pool ---
+void BufferPool::adopt(cv::Mat& mat)
+{
+    mat.allocator = instance();
+}
+
+// --- Give every idle buffer back to the heap ---
+void BufferPool::trim()
+{
+    QMutexLocker locker(&mutex);
+
+    QHash< size_t, QVector<void*> >::iterator bucket;
+    for (bucket = idleBuffers.begin(); bucket != idleBuffers.end(); ++bucket)
+    {
+        for (int index=0; index < bucket->size(); index++)
+        {
+            cv::fastFree(bucket->at(index));
+        }
+    }
+    idleBuffers.clear();
+    counters.bytesRetained = 0;
+}
+
+// ----- cv::MatAllocator -----------------------------------------------------
+// --- Same step layout as OpenCV's standard allocator, pooled storage ---
+cv::UMatData* BufferPool::allocate(int dims, const int* sizes, int type,
+                                   void* data0, size_t* step, int /*flags*/,
+                                   cv::UMatUsageFlags /*usageFlags*/) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i=dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != CV_AUTOSTEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar *data = static_cast<uchar*>(data0);
+
+    if (!data && total >= minimumPooledBytes)
+    {
+        size_t bucket = bucketSize(total);
+        QMutexLocker locker(&mutex);
+
+        QVector<void*>& idle = idleBuffers[bucket];
+        if (!idle.isEmpty())
+        {
+            data = static_cast<uchar*>(idle.takeLast());
+            counters.bytesRetained -= bucket;
+            counters.hits++;
+        }
+        else
+        {
+            counters.misses++;
+        }
+        counters.bytesInUse += bucket;
+
+        if (!data)
+        {
+            locker.unlock();
+            data = static_cast<uchar*>(cv::fastMalloc(bucket));
+        }
+    }
+    else if (!data)
+    {
+        data = static_cast<uchar*>(cv::fastMalloc(total));
+    }
+
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0)
+    {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return u;
+}
+
+bool BufferPool::allocate(cv::UMatData* u, int /*accessFlags*/,
+                          cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return u != 0;
+}
+
+void BufferPool::deallocate(cv::UMatData* u) const
+{
+    if (!u)
+    {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        if (u->size >= minimumPooledBytes)
+        {
+            size_t bucket = bucketSize(u->size);
+            QMutexLocker locker(&mutex);
+
+            counters.bytesInUse -= bucket;
+            if (size_t(counters.bytesRetained) + bucket <= retainedLimit)
+            {
+                idleBuffers[bucket].append(u->origdata);
+                counters.bytesRetained += bucket;
+                u->origdata = 0;
+            }
+        }
+
+        if (u->origdata)
+        {
+            cv::fastFree(u->origdata);
+            u->origdata = 0;
+        }
+    }
+    delete u;
+}
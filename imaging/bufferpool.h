@@ -0,0 +1,58 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include <opencv2/core/core.hpp>
+
+// --- Size-bucketed recycler for image-sized buffers. ---
+// Installed as the cv::MatAllocator of the imaging module's Mats, so a buffer
+// released by one edit is handed to the next allocation of a similar size
+// instead of going back to the heap (and faulting in fresh pages).
+class BufferPool : public cv::MatAllocator
+{
+public:
+    struct Statistics
+    {
+        qint64 hits;            // allocations served from the pool
+        qint64 misses;          // allocations that went to the heap
+        qint64 bytesRetained;   // idle bytes currently held for reuse
+        qint64 bytesInUse;      // pooled bytes currently held by Mats
+    };
+
+    // --- Constructor / Destructor ---
+    BufferPool(size_t minimumBytes = 256 * 1024,
+               size_t retainedLimitBytes = size_t(512) * 1024 * 1024);
+    ~BufferPool();
+
+    static BufferPool* instance();
+
+    // --- Accessors ---
+    Statistics statistics() const;
+    static size_t bucketSize(size_t bytes);
+
+    // --- Explicit API ---
+    cv::Mat acquire(int rows, int cols, int type);
+    static void adopt(cv::Mat& mat);
+    void trim();
+
+    // --- cv::MatAllocator ---
+    cv::UMatData* allocate(int dims, const int* sizes, int type,
+                           void* data, size_t* step, int flags,
+                           cv::UMatUsageFlags usageFlags) const;
+    bool allocate(cv::UMatData* u, int accessFlags,
+                  cv::UMatUsageFlags usageFlags) const;
+    void deallocate(cv::UMatData* u) const;
+
+private:
+    size_t minimumPooledBytes;
+    size_t retainedLimit;
+
+    mutable QMutex mutex;
+    mutable QHash< size_t, QVector<void*> > idleBuffers;
+    mutable Statistics counters;
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,521 @@
+#include "colorlut3d.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+// ----- Parse Cache ----------------------------------------------------------
+namespace {
+
+struct CachedCube
+{
+    QDateTime modified;
+    qint64 bytes;
+    ColorLUT3D lut;
+};
+
+QMutex cubeCacheMutex;
+QHash<QString, CachedCube> cubeCache;
+
+// --- Tetrahedral interpolation over stripes of rows ---
+class TetrahedralStripes : public cv::ParallelLoopBody
+{
+public:
+    TetrahedralStripes(const ColorLUT3D& cube,
+                       const cv::Mat& inputImage,
+                       cv::Mat& outputImage)
+        : lut(cube), input(inputImage), output(outputImage)
+    {
+        const int stride[3] = { ColorLUT3D::tableStride,
+                                ColorLUT3D::tableStride * lut.size,
+                                ColorLUT3D::tableStride * lut.size * lut.size };
+
+        // --- Node offset and fraction for every 8-bit value, per RGB axis ---
+        for (int axis=0; axis < 3; axis++)
+        {
+            double span = lut.domainMax[axis] - lut.domainMin[axis];
+            if (span <= 0.0)
+            {
+                span = 1.0;
+            }
+            corner[axis] = stride[axis];
+
+            for (int value=0; value < 256; value++)
+            {
+                double x = (value / 255.0 - lut.domainMin[axis]) / span;
+                x = std::max(0.0, std::min(1.0, x)) * (lut.size - 1);
+
+                int lower = std::min(static_cast<int>(x), lut.size - 2);
+                offset[axis][value] = lower * stride[axis];
+                fraction[axis][value] = static_cast<float>(x - lower);
+            }
+        }
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        const float *table = &lut.table[0];
+        const int sR = corner[0];
+        const int sG = corner[1];
+        const int sB = corner[2];
+
+        for (int row=range.start; row < range.end; row++)
+        {
+            const uchar *source = input.ptr<uchar>(row);
+            uchar *target = output.ptr<uchar>(row);
+
+            for (int col=0; col < input.cols; col++, source += 3, target += 3)
+            {
+                const int b = source[0];
+                const int g = source[1];
+                const int r = source[2];
+                const float fr = fraction[0][r];
+                const float fg = fraction[1][g];
+                const float fb = fraction[2][b];
+
+                const float *c000 = table + offset[0][r] + offset[1][g] + offset[2][b];
+                const float *c111 = c000 + sR + sG + sB;
+                const float *cA;
+                const float *cB;
+                float w0, w1, w2, w3;
+
+                // --- Pick the tetrahedron by ordering the fractions ---
+                if (fr > fg)
+                {
+                    if (fg > fb)
+                    {
+                        cA = c000 + sR; cB = c000 + sR + sG;
+                        w0 = 1.0f - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+                    }
+                    else if (fr > fb)
+                    {
+                        cA = c000 + sR; cB = c000 + sR + sB;
+                        w0 = 1.0f - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+                    }
+                    else
+                    {
+                        cA = c000 + sB; cB = c000 + sR + sB;
+                        w0 = 1.0f - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+                    }
+                }
+                else
+                {
+                    if (fb > fg)
+                    {
+                        cA = c000 + sB; cB = c000 + sG + sB;
+                        w0 = 1.0f - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+                    }
+                    else if (fb > fr)
+                    {
+                        cA = c000 + sG; cB = c000 + sG + sB;
+                        w0 = 1.0f - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+                    }
+                    else
+                    {
+                        cA = c000 + sG; cB = c000 + sR + sG;
+                        w0 = 1.0f - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+                    }
+                }
+
+                // --- Weighted sum of four padded RGB nodes, scaled to 8-bit ---
+                float rgb[4];
+#if CV_SIMD128
+                cv::v_float32x4 sum = cv::v_load(c000) * cv::v_setall_f32(255.0f * w0)
+                                    + cv::v_load(cA) * cv::v_setall_f32(255.0f * w1)
+                                    + cv::v_load(cB) * cv::v_setall_f32(255.0f * w2)
+                                    + cv::v_load(c111) * cv::v_setall_f32(255.0f * w3);
+                cv::v_store(rgb, sum);
+#else
+                for (int channel=0; channel < 3; channel++)
+                {
+                    rgb[channel] = 255.0f * (w0 * c000[channel] + w1 * cA[channel]
+                                           + w2 * cB[channel] + w3 * c111[channel]);
+                }
+#endif
+                target[0] = cv::saturate_cast<uchar>(rgb[2]);
+                target[1] = cv::saturate_cast<uchar>(rgb[1]);
+                target[2] = cv::saturate_cast<uchar>(rgb[0]);
+            }
+        }
+    }
+
+private:
+    const ColorLUT3D& lut;
+    const cv::Mat& input;
+    cv::Mat& output;
+    int corner[3];
+    int offset[3][256];
+    float fraction[3][256];
+};
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+ColorLUT3D::ColorLUT3D()
+{
+    size = 0;
+    for (int axis=0; axis < 3; axis++)
+    {
+        domainMin[axis] = 0.0f;
+        domainMax[axis] = 1.0f;
+    }
+}
+
+ColorLUT3D::ColorLUT3D(int points)
+{
+    size = points;
+    for (int axis=0; axis < 3; axis++)
+    {
+        domainMin[axis] = 0.0f;
+        domainMax[axis] = 1.0f;
+    }
+    table.assign(tableStride * points * points * points, 0.0f);
+}
+
+ColorLUT3D::~ColorLUT3D()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool ColorLUT3D::isValid() const
+{
+    return size >= 2 && table.size() == size_t(tableStride * size * size * size);
+}
+
+float* ColorLUT3D::node(int r, int g, int b)
+{
+    return &table[tableStride * (r + size * (g + size * b))];
+}
+
+const float* ColorLUT3D::node(int r, int g, int b) const
+{
+    return &table[tableStride * (r + size * (g + size * b))];
+}
+
+// --- Tetrahedral lookup of a single RGB value in 0..1, in place ---
+void ColorLUT3D::lookup(float rgb[3]) const
+{
+    int lower[3];
+    float f[3];
+
+    for (int axis=0; axis < 3; axis++)
+    {
+        float span = domainMax[axis] - domainMin[axis];
+        float x = (rgb[axis] - domainMin[axis]) / (span > 0.0f ? span : 1.0f);
+        x = std::max(0.0f, std::min(1.0f, x)) * (size - 1);
+
+        lower[axis] = std::min(static_cast<int>(x), size - 2);
+        f[axis] = x - lower[axis];
+    }
+
+    const float *c000 = node(lower[0], lower[1], lower[2]);
+    const float *c111 = node(lower[0] + 1, lower[1] + 1, lower[2] + 1);
+    const float *cA;
+    const float *cB;
+    float w0, w1, w2, w3;
+    const float fr = f[0], fg = f[1], fb = f[2];
+
+    if (fr > fg)
+    {
+        if (fg > fb)
+        {
+            cA = node(lower[0] + 1, lower[1], lower[2]);
+            cB = node(lower[0] + 1, lower[1] + 1, lower[2]);
+            w0 = 1.0f - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+        }
+        else if (fr > fb)
+        {
+            cA = node(lower[0] + 1, lower[1], lower[2]);
+            cB = node(lower[0] + 1, lower[1], lower[2] + 1);
+            w0 = 1.0f - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+        }
+        else
+        {
+            cA = node(lower[0], lower[1], lower[2] + 1);
+            cB = node(lower[0] + 1, lower[1], lower[2] + 1);
+            w0 = 1.0f - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+        }
+    }
+    else
+    {
+        if (fb > fg)
+        {
+            cA = node(lower[0], lower[1], lower[2] + 1);
+            cB = node(lower[0], lower[1] + 1, lower[2] + 1);
+            w0 = 1.0f - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+        }
+        else if (fb > fr)
+        {
+            cA = node(lower[0], lower[1] + 1, lower[2]);
+            cB = node(lower[0], lower[1] + 1, lower[2] + 1);
+            w0 = 1.0f - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+        }
+        else
+        {
+            cA = node(lower[0], lower[1] + 1, lower[2]);
+            cB = node(lower[0] + 1, lower[1] + 1, lower[2]);
+            w0 = 1.0f - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+        }
+    }
+
+    for (int channel=0; channel < 3; channel++)
+    {
+        rgb[channel] = w0 * c000[channel] + w1 * cA[channel]
+                     + w2 * cB[channel] + w3 * c111[channel];
+    }
+}
+
+// --- Write the table as an Adobe/Resolve .cube file ---
+bool ColorLUT3D::saveCube(QString filePath) const
+{
+    QFile file(filePath);
+
+    if (!isValid() || !file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(6);
+
+    if (!title.isEmpty())
+    {
+        out << "TITLE \"" << title << "\"\n";
+    }
+    out << "LUT_3D_SIZE " << size << "\n";
+    out << "DOMAIN_MIN " << domainMin[0] << " " << domainMin[1] << " " << domainMin[2] << "\n";
+    out << "DOMAIN_MAX " << domainMax[0] << " " << domainMax[1] << " " << domainMax[2] << "\n";
+
+    for (int b=0; b < size; b++)
+    {
+        for (int g=0; g < size; g++)
+        {
+            for (int r=0; r < size; r++)
+            {
+                const float *rgb = node(r, g, b);
+                out << rgb[0] << " " << rgb[1] << " " << rgb[2] << "\n";
+            }
+        }
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+// --- Map an 8-bit BGR image through the table, rows split across threads ---
+void ColorLUT3D::apply(const cv::Mat& inputImage, cv::Mat& outputImage) const
+{
+    CV_Assert(isValid() && inputImage.type() == CV_8UC3);
+
+    outputImage.create(inputImage.size(), inputImage.type());
+    cv::parallel_for_(cv::Range(0, inputImage.rows),
+                      TetrahedralStripes(*this, inputImage, outputImage));
+}
+
+// ----- Factories ------------------------------------------------------------
+ColorLUT3D ColorLUT3D::identity(int points)
+{
+    ColorLUT3D result(points);
+    float step = 1.0f / (points - 1);
+
+    for (int b=0; b < points; b++)
+    {
+        for (int g=0; g < points; g++)
+        {
+            for (int r=0; r < points; r++)
+            {
+                float *rgb = result.node(r, g, b);
+                rgb[0] = r * step;
+                rgb[1] = g * step;
+                rgb[2] = b * step;
+            }
+        }
+    }
+    return result;
+}
+
+// --- Bake a 1x256 CV_8UC3 per-channel table (as built by MyImage) ---
+ColorLUT3D ColorLUT3D::fromChannelLUT(const cv::Mat& channelLUT, int points)
+{
+    ColorLUT3D result = identity(points);
+
+    if (channelLUT.empty())
+    {
+        return result;
+    }
+
+    // --- Each axis is independent, so interpolate the 1D curves once ---
+    const cv::Vec3b *entry = channelLUT.ptr<cv::Vec3b>(0);
+    std::vector<float> curve[3];
+
+    for (int axis=0; axis < 3; axis++)
+    {
+        int channel = 2 - axis; // RGB axis to BGR entry
+        curve[axis].resize(points);
+
+        for (int i=0; i < points; i++)
+        {
+            float x = 255.0f * i / (points - 1);
+            int lower = std::min(static_cast<int>(x), 254);
+            float t = x - lower;
+
+            curve[axis][i] = ((1.0f - t) * entry[lower][channel]
+                              + t * entry[lower + 1][channel]) / 255.0f;
+        }
+    }
+
+    for (int b=0; b < points; b++)
+    {
+        for (int g=0; g < points; g++)
+        {
+            for (int r=0; r < points; r++)
+            {
+                float *rgb = result.node(r, g, b);
+                rgb[0] = curve[0][r];
+                rgb[1] = curve[1][g];
+                rgb[2] = curve[2][b];
+            }
+        }
+    }
+    return result;
+}
+
+// --- Parse a .cube file, reusing the previous parse while the file is unchanged ---
+ColorLUT3D ColorLUT3D::loadCube(QString filePath, QString *errorString)
+{
+    QFileInfo info(filePath);
+    QString key = info.canonicalFilePath();
+
+    {
+        QMutexLocker locker(&cubeCacheMutex);
+        QHash<QString, CachedCube>::const_iterator cached = cubeCache.constFind(key);
+
+        if (cached != cubeCache.constEnd()
+                && cached->modified == info.lastModified()
+                && cached->bytes == info.size())
+        {
+            return cached->lut;
+        }
+    }
+
+    ColorLUT3D result;
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        if (errorString) *errorString = QString("Cannot open ") + filePath;
+        return ColorLUT3D();
+    }
+
+    QTextStream in(&file);
+    int nodeCount = 0;
+
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().simplified();
+
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        QStringList fields = line.split(' ');
+        const QString& keyword = fields.at(0);
+
+        if (keyword == "TITLE")
+        {
+            result.title = line.mid(6).remove('"');
+        }
+        else if (keyword == "LUT_3D_SIZE" && fields.size() == 2)
+        {
+            int points = fields.at(1).toInt();
+            if (points < 2 || points > 256)
+            {
+                if (errorString) *errorString = QString("Unsupported LUT_3D_SIZE ") + fields.at(1);
+                return ColorLUT3D();
+            }
+            result.size = points;
+            result.table.assign(tableStride * points * points * points, 0.0f);
+        }
+        else if ((keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX") && fields.size() == 4)
+        {
+            float *domain = (keyword == "DOMAIN_MIN") ? result.domainMin : result.domainMax;
+            for (int axis=0; axis < 3; axis++)
+            {
+                bool valid = false;
+                domain[axis] = fields.at(axis + 1).toFloat(&valid);
+                if (!valid)
+                {
+                    if (errorString) *errorString = QString("Bad ") + keyword + QString(" in ") + filePath;
+                    return ColorLUT3D();
+                }
+            }
+        }
+        else if (keyword == "LUT_1D_SIZE")
+        {
+            if (errorString) *errorString = QString("1D .cube tables are not supported");
+            return ColorLUT3D();
+        }
+        else
+        {
+            // --- Table rows start with a number; other keywords are skipped ---
+            bool numeric = false;
+            keyword.toFloat(&numeric);
+            if (!numeric)
+            {
+                continue;
+            }
+
+            if (fields.size() != 3 || result.size == 0
+                    || nodeCount >= result.size * result.size * result.size)
+            {
+                if (errorString) *errorString = QString("Unexpected table data in ") + filePath;
+                return ColorLUT3D();
+            }
+
+            float *rgb = &result.table[tableStride * nodeCount];
+            for (int axis=0; axis < 3; axis++)
+            {
+                bool valid = false;
+                rgb[axis] = fields.at(axis).toFloat(&valid);
+                if (!valid)
+                {
+                    if (errorString) *errorString = QString("Bad table data in ") + filePath;
+                    return ColorLUT3D();
+                }
+            }
+            nodeCount++;
+        }
+    }
+
+    if (result.size == 0 || nodeCount != result.size * result.size * result.size)
+    {
+        if (errorString) *errorString = QString("Incomplete table in ") + filePath;
+        return ColorLUT3D();
+    }
+
+    QMutexLocker locker(&cubeCacheMutex);
+    CachedCube entry;
+    entry.modified = info.lastModified();
+    entry.bytes = info.size();
+    entry.lut = result;
+    cubeCache.insert(key, entry);
+
+    return result;
+}
+
+void ColorLUT3D::clearCache()
+{
+    QMutexLocker locker(&cubeCacheMutex);
+    cubeCache.clear();
+}
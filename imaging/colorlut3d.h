@@ -0,0 +1,43 @@
+#ifndef COLORLUT3D_H
+#define COLORLUT3D_H
+
+#include <vector>
+
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+class ColorLUT3D
+{
+public:
+    // --- Constructor / Destructor ---
+    ColorLUT3D();
+    ColorLUT3D(int points);
+    ~ColorLUT3D();
+
+    // --- Members ---
+    static const int tableStride = 4; // RGB padded to four floats per node
+
+    QString title;
+    int size;                  // nodes per axis, e.g. 17, 33 or 65
+    float domainMin[3];        // RGB
+    float domainMax[3];        // RGB
+    std::vector<float> table;  // size^3 nodes, red fastest as in .cube, 0..1
+
+    // --- Accessors ---
+    bool isValid() const;
+    float* node(int r, int g, int b);
+    const float* node(int r, int g, int b) const;
+
+    void lookup(float rgb[3]) const;
+    bool saveCube(QString filePath) const;
+    void apply(const cv::Mat& inputImage, cv::Mat& outputImage) const;
+
+    // --- Factories ---
+    static ColorLUT3D identity(int points);
+    static ColorLUT3D fromChannelLUT(const cv::Mat& channelLUT, int points = 33);
+    static ColorLUT3D loadCube(QString filePath, QString *errorString = 0);
+    static void clearCache();
+};
+
+#endif // COLORLUT3D_H
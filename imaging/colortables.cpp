@@ -0,0 +1,152 @@
+#include "colortables.h"
+
+namespace ColorTables {
+
+namespace {
+
+constexpr double LN2 = 0.69314718055994530942;
+
+// ----- constexpr math (compile time only, not meant for per-pixel use) -----
+constexpr double cosine(double x)
+{
+    // --- Reduce to [-pi, pi] then sum the Taylor series ---
+    while (x > PI)
+    {
+        x -= 2.0 * PI;
+    }
+    while (x < -PI)
+    {
+        x += 2.0 * PI;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n=1; n < 30; n++)
+    {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double exponential(double x)
+{
+    // --- exp(x) = 2^k * exp(r), |r| <= ln2 / 2 ---
+    int k = 0;
+    while (x > 0.5 * LN2)
+    {
+        x -= LN2;
+        k++;
+    }
+    while (x < -0.5 * LN2)
+    {
+        x += LN2;
+        k--;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n=1; n < 20; n++)
+    {
+        term *= x / n;
+        sum += term;
+    }
+    for (; k > 0; k--)
+    {
+        sum *= 2.0;
+    }
+    for (; k < 0; k++)
+    {
+        sum *= 0.5;
+    }
+    return sum;
+}
+
+constexpr double logarithm(double x)
+{
+    // --- ln(x) = k ln2 + 2 atanh((m - 1) / (m + 1)), m in [0.5, 1] ---
+    int k = 0;
+    while (x > 1.0)
+    {
+        x *= 0.5;
+        k++;
+    }
+    while (x < 0.5)
+    {
+        x *= 2.0;
+        k--;
+    }
+    double z = (x - 1.0) / (x + 1.0);
+    double power = z;
+    double sum = 0.0;
+    for (int n=0; n < 40; n++)
+    {
+        sum += power / (2 * n + 1);
+        power *= z * z;
+    }
+    return k * LN2 + 2.0 * sum;
+}
+
+constexpr double power(double x, double exponent)
+{
+    return x <= 0.0 ? 0.0 : exponential(exponent * logarithm(x));
+}
+
+constexpr double srgbToLinear(double x)
+{
+    return x <= 0.04045 ? x / 12.92 : power((x + 0.055) / 1.055, 2.4);
+}
+
+constexpr double linearToSRGB(double x)
+{
+    return x <= 0.0031308 ? 12.92 * x : 1.055 * power(x, 1.0 / 2.4) - 0.055;
+}
+
+struct CosineFunction { constexpr double operator()(double x) const { return cosine(x); } };
+struct SRGBToLinearFunction { constexpr double operator()(double x) const { return srgbToLinear(x); } };
+struct LinearToSRGBFunction { constexpr double operator()(double x) const { return linearToSRGB(x); } };
+
+// ----- Table builders -------------------------------------------------------
+template <int Size, typename Function>
+constexpr detail::Table<Size> sample(Function f, double low, double high)
+{
+    detail::Table<Size> table = {};
+    table.low = low;
+    table.high = high;
+    for (int i=0; i <= Size; i++)
+    {
+        table.value[i] = static_cast<float>(f(low + (high - low) * i / Size));
+    }
+    return table;
+}
+
+constexpr detail::SRGBDecodeTable decodeTable()
+{
+    detail::SRGBDecodeTable table = {};
+    for (int code=0; code < 256; code++)
+    {
+        table.value[code] = static_cast<float>(srgbToLinear(code / 255.0));
+    }
+    return table;
+}
+
+constexpr detail::SRGBEncodeTable encodeTable()
+{
+    const int size = detail::SRGBEncodeTable::size;
+    detail::SRGBEncodeTable table = {};
+    for (int i=0; i <= size; i++)
+    {
+        table.value[i] = static_cast<unsigned char>(255.0 * linearToSRGB(1.0 * i / size) + 0.5);
+    }
+    return table;
+}
+
+}
+
+// ----- Tables ---------------------------------------------------------------
+// --- constexpr, so a generator that stops being constant fails the build ---
+constexpr detail::Table<4096> detail::cosineTable = sample<4096>(CosineFunction(), 0.0, 2.0 * PI);
+constexpr detail::Table<1024> detail::srgbToLinearTable = sample<1024>(SRGBToLinearFunction(), 0.0, 1.0);
+constexpr detail::Table<1024> detail::linearToSRGBTable = sample<1024>(LinearToSRGBFunction(), 0.0, 1.0);
+constexpr detail::SRGBDecodeTable detail::srgbDecodeTable = decodeTable();
+constexpr detail::SRGBEncodeTable detail::srgbEncodeTable = encodeTable();
+
+}
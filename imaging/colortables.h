@@ -0,0 +1,104 @@
+#ifndef COLORTABLES_H
+#define COLORTABLES_H
+
+// --- Lookup tables for the math used in color conversion. ---
+// The tables are built once, by constexpr code in colortables.cpp, so they
+// live in read-only data and cost nothing at startup. Only functions whose
+// linear interpolation error stays small over the whole table are tabled:
+// cos is, acos and sqrt near zero are not, and are left to the C library.
+
+namespace ColorTables {
+
+constexpr double PI = 3.14159265358979323846;
+
+namespace detail {
+
+// --- Samples of f over [low, high] at Size + 1 evenly spaced points ---
+template <int Size>
+struct Table
+{
+    float value[Size + 1];
+    double low;
+    double high;
+
+    float operator()(double x) const
+    {
+        double position = (x - low) * (Size / (high - low));
+        if (position <= 0.0)
+        {
+            return value[0];
+        }
+        if (position >= Size)
+        {
+            return value[Size];
+        }
+        int index = static_cast<int>(position);
+        float t = static_cast<float>(position - index);
+        return value[index] + t * (value[index + 1] - value[index]);
+    }
+};
+
+// --- 8-bit sRGB code value to linear light, exact per code ---
+struct SRGBDecodeTable
+{
+    float value[256];
+};
+
+// --- Linear light quantized to 12 bits back to an 8-bit sRGB code ---
+struct SRGBEncodeTable
+{
+    static const int size = 4096;
+    unsigned char value[size + 1];
+};
+
+extern const Table<4096> cosineTable;
+extern const Table<1024> srgbToLinearTable;
+extern const Table<1024> linearToSRGBTable;
+extern const SRGBDecodeTable srgbDecodeTable;
+extern const SRGBEncodeTable srgbEncodeTable;
+
+}
+
+// ----- Lookups --------------------------------------------------------------
+// --- cos over any angle in radians ---
+inline float cosine(double x)
+{
+    double turn = 2.0 * PI;
+    if (x < 0.0 || x > turn)
+    {
+        x -= turn * static_cast<int>(x / turn);
+        if (x < 0.0)
+        {
+            x += turn;
+        }
+    }
+    return detail::cosineTable(x);
+}
+
+inline float srgbToLinear(unsigned char code)
+{
+    return detail::srgbDecodeTable.value[code];
+}
+
+inline unsigned char linearToSRGB(float x)
+{
+    const int size = detail::SRGBEncodeTable::size;
+    int index = static_cast<int>(x * size + 0.5f);
+    index = index < 0 ? 0 : (index > size ? size : index);
+    return detail::srgbEncodeTable.value[index];
+}
+
+// --- Float sRGB decode and encode, 0..1, interpolated ---
+inline float srgbToLinearFloat(float x)
+{
+    return detail::srgbToLinearTable(x);
+}
+
+inline float linearToSRGBFloat(float x)
+{
+    return detail::linearToSRGBTable(x);
+}
+
+}
+
+#endif // COLORTABLES_H
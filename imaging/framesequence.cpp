@@ -0,0 +1,164 @@
+#include "framesequence.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace {
+
+const QRegularExpression patternField("%(0?)(\\d*)d");
+
+bool isImageSuffix(QString suffix)
+{
+    static const QStringList suffixes = QStringList()
+            << "png" << "jpg" << "jpeg" << "tif" << "tiff" << "bmp" << "webp" << "ict";
+    return suffixes.contains(suffix.toLower());
+}
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+FrameSequence::FrameSequence()
+{
+    rate = 24.0;
+    opened = false;
+}
+
+FrameSequence::~FrameSequence()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool FrameSequence::isOpen() const
+{
+    return opened;
+}
+
+bool FrameSequence::isVideo() const
+{
+    return opened && paths.isEmpty();
+}
+
+int FrameSequence::frameCount() const
+{
+    if (!isVideo())
+    {
+        return paths.size();
+    }
+
+    int count = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+    return count > 0 ? count : -1;
+}
+
+double FrameSequence::framesPerSecond() const
+{
+    return rate;
+}
+
+QString FrameSequence::framePath(int index) const
+{
+    return index >= 0 && index < paths.size() ? paths.at(index) : QString();
+}
+
+// ----- Mutators -------------------------------------------------------------
+bool FrameSequence::open(QString source, QString *errorString)
+{
+    close();
+
+    if (isPattern(source))
+    {
+        // --- Numbering starts at 0 or 1 and runs until the first gap ---
+        for (int first=0; first <= 1 && paths.isEmpty(); first++)
+        {
+            for (int index=first; QFileInfo::exists(expandPattern(source, index)); index++)
+            {
+                paths.append(expandPattern(source, index));
+            }
+        }
+    }
+    else if (QFileInfo(source).isDir())
+    {
+        QFileInfoList entries = QDir(source).entryInfoList(QDir::Files, QDir::Name);
+        for (int index=0; index < entries.size(); index++)
+        {
+            if (isImageSuffix(entries.at(index).suffix()))
+            {
+                paths.append(entries.at(index).absoluteFilePath());
+            }
+        }
+    }
+    else
+    {
+        if (!capture.open(source.toStdString()))
+        {
+            if (errorString) *errorString = QString("Cannot open video ") + source;
+            return false;
+        }
+
+        double reported = capture.get(cv::CAP_PROP_FPS);
+        if (reported > 0.0)
+        {
+            rate = reported;
+        }
+        opened = true;
+        return true;
+    }
+
+    if (paths.isEmpty())
+    {
+        if (errorString) *errorString = QString("No frames found for ") + source;
+        return false;
+    }
+
+    opened = true;
+    return true;
+}
+
+// --- Next video frame, decoded into frame's buffer when the size matches ---
+bool FrameSequence::readFrame(cv::Mat& frame)
+{
+    if (!isVideo())
+    {
+        return false;
+    }
+    return capture.read(frame) && !frame.empty();
+}
+
+void FrameSequence::close()
+{
+    if (capture.isOpened())
+    {
+        capture.release();
+    }
+    paths.clear();
+    rate = 24.0;
+    opened = false;
+}
+
+// ----- Naming ---------------------------------------------------------------
+bool FrameSequence::isPattern(QString path)
+{
+    return patternField.match(path).hasMatch();
+}
+
+bool FrameSequence::isVideoFile(QString path)
+{
+    static const QStringList suffixes = QStringList()
+            << "avi" << "mp4" << "m4v" << "mov" << "mkv" << "mpg" << "mpeg" << "webm";
+    return suffixes.contains(QFileInfo(path).suffix().toLower());
+}
+
+// --- "%04d" becomes the zero-padded index, "%d" the plain one ---
+QString FrameSequence::expandPattern(QString pattern, int index)
+{
+    QRegularExpressionMatch match = patternField.match(pattern);
+    if (!match.hasMatch())
+    {
+        return pattern;
+    }
+
+    QChar fill = match.captured(1).isEmpty() ? QChar(' ') : QChar('0');
+    QString number = QString("%1").arg(index, match.captured(2).toInt(), 10, fill);
+    return pattern.left(match.capturedStart()) + number + pattern.mid(match.capturedEnd());
+}
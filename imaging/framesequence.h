@@ -0,0 +1,46 @@
+#ifndef FRAMESEQUENCE_H
+#define FRAMESEQUENCE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+// --- Ordered frames from a video file, a numbered pattern or a folder. ---
+// Patterns use printf-style numbering ("shot_%04d.png") and start at 0 or 1.
+// Image frames are listed when the sequence is opened, so several threads can
+// decode them out of order; a video can only be read front to back, by one
+// thread, with each frame decoded into the caller's buffer.
+class FrameSequence
+{
+public:
+    // --- Constructor / Destructor ---
+    FrameSequence();
+    ~FrameSequence();
+
+    // --- Accessors ---
+    bool isOpen() const;
+    bool isVideo() const;
+    int frameCount() const;             // -1 when a video does not say
+    double framesPerSecond() const;
+    QString framePath(int index) const;
+
+    // --- Mutators ---
+    bool open(QString source, QString *errorString = 0);
+    bool readFrame(cv::Mat& frame);
+    void close();
+
+    // --- Naming ---
+    static bool isPattern(QString path);
+    static bool isVideoFile(QString path);
+    static QString expandPattern(QString pattern, int index);
+
+private:
+    cv::VideoCapture capture;
+    QStringList paths;
+    double rate;
+    bool opened;
+};
+
+#endif // FRAMESEQUENCE_H
@@ -0,0 +1,294 @@
+#include "imageexporter.h"
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QThread>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "pngwriter.h"
+
+namespace {
+
+// --- imwrite / imencode parameters for the OpenCV encoded formats ---
+std::vector<int> encoderParameters(const ExportOptions& options)
+{
+    std::vector<int> parameters;
+
+    switch (options.format)
+    {
+    case ExportOptions::PNGFormat:
+        parameters.push_back(cv::IMWRITE_PNG_COMPRESSION);
+        parameters.push_back(options.pngCompression);
+        break;
+
+    case ExportOptions::JPEGFormat:
+        parameters.push_back(cv::IMWRITE_JPEG_QUALITY);
+        parameters.push_back(options.jpegQuality);
+        parameters.push_back(cv::IMWRITE_JPEG_OPTIMIZE);
+        parameters.push_back(options.jpegOptimize ? 1 : 0);
+        parameters.push_back(cv::IMWRITE_JPEG_PROGRESSIVE);
+        parameters.push_back(options.jpegProgressive ? 1 : 0);
+        break;
+
+    case ExportOptions::WebPFormat:
+        parameters.push_back(cv::IMWRITE_WEBP_QUALITY);
+        parameters.push_back(options.webpQuality);
+        break;
+
+    default:
+        break;
+    }
+    return parameters;
+}
+
+const char* encoderExtension(ExportOptions::Format format)
+{
+    switch (format)
+    {
+    case ExportOptions::JPEGFormat:
+        return ".jpg";
+    case ExportOptions::WebPFormat:
+        return ".webp";
+    case ExportOptions::TIFFFormat:
+        return ".tiff";
+    default:
+        return ".png";
+    }
+}
+
+// --- Encode a private copy of the image, report back queued ---
+class ExportJob : public QRunnable
+{
+public:
+    ExportJob(QObject *jobOwner,
+              QString outputFile,
+              const cv::Mat& outputImage,
+              const ExportOptions& exportOptions)
+        : owner(jobOwner), filePath(outputFile), image(outputImage), options(exportOptions) {}
+
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        bool succeeded = ImageExporter::write(filePath, image, options);
+        image.release();
+
+        QMetaObject::invokeMethod(owner, "jobFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, filePath),
+                                  Q_ARG(bool, succeeded),
+                                  Q_ARG(qint64, timer.elapsed()));
+    }
+
+private:
+    QObject *owner;
+    QString filePath;
+    cv::Mat image;
+    ExportOptions options;
+};
+
+}
+
+// ----- Export Options -------------------------------------------------------
+ExportOptions::ExportOptions()
+{
+    format = PNGFormat;
+    pngCompression = 3;
+    jpegQuality = 92;
+    jpegOptimize = false;
+    jpegProgressive = false;
+    webpQuality = 90;
+    rawCodec = TiledImageFile::LZ4Codec;
+}
+
+QString ExportOptions::formatName() const
+{
+    switch (format)
+    {
+    case JPEGFormat:
+        return QString("JPEG (quality %1)").arg(jpegQuality);
+    case WebPFormat:
+        return webpQuality > 100 ? QString("WebP (lossless)")
+                                 : QString("WebP (quality %1)").arg(webpQuality);
+    case TIFFFormat:
+        return QString("TIFF");
+    case RawFormat:
+        return rawCodec == TiledImageFile::LZ4Codec ? QString("work image (LZ4)")
+                                                    : QString("work image (raw)");
+    default:
+        return QString("PNG (level %1)").arg(pngCompression);
+    }
+}
+
+// --- Preview favours encode time, archival favours file size ---
+ExportOptions ExportOptions::forEffort(Effort effort, Format format)
+{
+    ExportOptions options;
+    options.format = format;
+
+    if (effort == PreviewEffort)
+    {
+        options.pngCompression = 1;
+        options.jpegQuality = 80;
+        options.webpQuality = 75;
+        options.rawCodec = TiledImageFile::RawCodec;
+    }
+    else if (effort == ArchivalEffort)
+    {
+        options.pngCompression = 9;
+        options.jpegQuality = 98;
+        options.jpegOptimize = true;
+        options.webpQuality = 101;
+    }
+    return options;
+}
+
+ExportOptions::Format ExportOptions::formatForPath(QString filePath)
+{
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+
+    if (suffix == "jpg" || suffix == "jpeg") return JPEGFormat;
+    if (suffix == "webp") return WebPFormat;
+    if (suffix == "tif" || suffix == "tiff") return TIFFFormat;
+    if (TiledImageFile::isTiledFile(filePath)) return RawFormat;
+    return PNGFormat;
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+ImageExporter::ImageExporter(int threads, QObject *parent) :
+    QObject(parent)
+{
+    // --- Encoders are parallel inside too, a few jobs at once is enough ---
+    if (threads <= 0)
+    {
+        threads = std::max(1, QThread::idealThreadCount() / 2);
+    }
+    pool.setMaxThreadCount(threads);
+}
+
+ImageExporter::~ImageExporter()
+{
+    pool.waitForDone();
+}
+
+// ----- Accessors ------------------------------------------------------------
+int ImageExporter::pendingCount() const
+{
+    return pending.load();
+}
+
+// ----- Mutators -------------------------------------------------------------
+void ImageExporter::exportImage(QString filePath, const cv::Mat& image, const ExportOptions& options)
+{
+    // --- The caller keeps editing its image, the job gets its own copy ---
+    pending.ref();
+    pool.start(new ExportJob(this, filePath, image.clone(), options));
+}
+
+void ImageExporter::waitForDone()
+{
+    pool.waitForDone();
+}
+
+void ImageExporter::jobFinished(QString filePath, bool succeeded, qint64 milliseconds)
+{
+    pending.deref();
+    emit exported(filePath, succeeded, milliseconds);
+}
+
+// ----- Encoding -------------------------------------------------------------
+// --- In memory; the tiled work image only exists as a file ---
+bool ImageExporter::encode(const cv::Mat& image,
+                           const ExportOptions& options,
+                           std::vector<uchar>& buffer,
+                           QString *errorString)
+{
+    if (image.empty() || options.format == ExportOptions::RawFormat)
+    {
+        if (errorString) *errorString = QString("Nothing to encode in this format");
+        return false;
+    }
+
+    if (options.format == ExportOptions::PNGFormat && PngWriter::isSupported(image))
+    {
+        return PngWriter::encode(image, buffer, options.pngCompression);
+    }
+
+    // --- OpenCV throws when no encoder matches or a parameter is rejected ---
+    try
+    {
+        if (!cv::imencode(encoderExtension(options.format), image, buffer, encoderParameters(options)))
+        {
+            if (errorString) *errorString = QString("No encoder for ") + options.formatName();
+            return false;
+        }
+    }
+    catch (const cv::Exception& exception)
+    {
+        if (errorString) *errorString = QString("Could not encode ") + options.formatName()
+                + QString(": ") + QString::fromStdString(exception.what());
+        return false;
+    }
+    return true;
+}
+
+QString ImageExporter::mimeType(ExportOptions::Format format)
+{
+    switch (format)
+    {
+    case ExportOptions::JPEGFormat:
+        return QString("image/jpeg");
+    case ExportOptions::WebPFormat:
+        return QString("image/webp");
+    case ExportOptions::TIFFFormat:
+        return QString("image/tiff");
+    case ExportOptions::RawFormat:
+        return QString("application/octet-stream");
+    default:
+        return QString("image/png");
+    }
+}
+
+bool ImageExporter::write(QString filePath,
+                          const cv::Mat& image,
+                          const ExportOptions& options,
+                          QString *errorString)
+{
+    if (image.empty())
+    {
+        if (errorString) *errorString = QString("Nothing to export");
+        return false;
+    }
+
+    if (options.format == ExportOptions::RawFormat)
+    {
+        return TiledImageFile::save(filePath, image, options.rawCodec,
+                                    TiledImageFile::defaultTileSize, errorString);
+    }
+    if (options.format == ExportOptions::PNGFormat && PngWriter::isSupported(image))
+    {
+        return PngWriter::write(filePath, image, options.pngCompression, 0, errorString);
+    }
+
+    // --- OpenCV throws when no encoder matches or a parameter is rejected ---
+    try
+    {
+        if (!cv::imwrite(filePath.toStdString(), image, encoderParameters(options)))
+        {
+            if (errorString) *errorString = QString("Could not write ") + filePath;
+            return false;
+        }
+    }
+    catch (const cv::Exception& exception)
+    {
+        if (errorString) *errorString = QString("No encoder for ") + filePath
+                + QString(": ") + QString::fromStdString(exception.what());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef IMAGEEXPORTER_H
+#define IMAGEEXPORTER_H
+
+#include <vector>
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <opencv2/core/core.hpp>
+
+#include "tiledimagefile.h"
+
+// --- Output format and encoder knobs; the format follows the file extension ---
+struct ExportOptions
+{
+    enum Format
+    {
+        PNGFormat,
+        JPEGFormat,
+        WebPFormat,
+        TIFFFormat,
+        RawFormat           // tiled work image, see TiledImageFile
+    };
+
+    enum Effort
+    {
+        PreviewEffort,      // fastest encoders, larger files
+        BalancedEffort,
+        ArchivalEffort      // slowest, highest ratio or lossless
+    };
+
+    Format format;
+    int pngCompression;     // 0..9
+    int jpegQuality;        // 0..100
+    bool jpegOptimize;      // extra Huffman pass, smaller and slower
+    bool jpegProgressive;
+    int webpQuality;        // 1..100, above 100 is lossless
+    TiledImageFile::Codec rawCodec;
+
+    ExportOptions();
+
+    QString formatName() const;
+
+    static ExportOptions forEffort(Effort effort, Format format = PNGFormat);
+    static Format formatForPath(QString filePath);
+};
+
+// --- Writes images in any supported format on a small encoder pool. ---
+// exportImage() copies the image and returns at once; exported() is emitted
+// on the owner's thread when the file is on disk, so the GUI never waits for
+// a slow archival encode.
+class ImageExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // --- Constructor / Destructor ---
+    explicit ImageExporter(int threads = 0, QObject *parent = 0);
+    ~ImageExporter();
+
+    // --- Accessors ---
+    int pendingCount() const;
+
+    // --- Mutators ---
+    void exportImage(QString filePath, const cv::Mat& image, const ExportOptions& options);
+    void waitForDone();
+
+    // --- Encoding ---
+    static bool encode(const cv::Mat& image,
+                       const ExportOptions& options,
+                       std::vector<uchar>& buffer,
+                       QString *errorString = 0);
+    static QString mimeType(ExportOptions::Format format);
+    static bool write(QString filePath,
+                      const cv::Mat& image,
+                      const ExportOptions& options,
+                      QString *errorString = 0);
+
+signals:
+    void exported(QString filePath, bool succeeded, qint64 milliseconds);
+
+private slots:
+    void jobFinished(QString filePath, bool succeeded, qint64 milliseconds);
+
+private:
+    QThreadPool pool;
+    QAtomicInt pending;
+};
+
+#endif // IMAGEEXPORTER_H
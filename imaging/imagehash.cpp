@@ -0,0 +1,325 @@
+#include "imagehash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/core/utility.hpp>
+
+// --- IMAGEHASH_SCALAR builds the portable lanes on x86 too, for the tests ---
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(IMAGEHASH_SCALAR)
+#define IMAGEHASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const quint64 prime32 = 0x9E3779B1ULL;
+const quint64 prime64a = 0x9E3779B185EBCA87ULL;
+const quint64 prime64b = 0x165667919E3779F9ULL;
+
+// --- Default secret, 24 words from splitmix64, built once ---
+struct DefaultSecret
+{
+    quint64 words[24];
+
+    DefaultSecret()
+    {
+        quint64 state = 0x243F6A8885A308D3ULL;
+        for (int index=0; index < 24; index++)
+        {
+            quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            words[index] = z ^ (z >> 31);
+        }
+    }
+};
+
+const DefaultSecret& defaultSecret()
+{
+    static const DefaultSecret secret;
+    return secret;
+}
+
+inline quint64 readWord(const uchar *bytes)
+{
+    quint64 word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+// --- Both halves of a 64x64 multiply folded together ---
+inline quint64 multiplyFold(quint64 a, quint64 b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<quint64>(product) ^ static_cast<quint64>(product >> 64);
+#else
+    quint64 lowLow = (a & 0xFFFFFFFFULL) * (b & 0xFFFFFFFFULL);
+    quint64 highLow = (a >> 32) * (b & 0xFFFFFFFFULL);
+    quint64 lowHigh = (a & 0xFFFFFFFFULL) * (b >> 32);
+    quint64 highHigh = (a >> 32) * (b >> 32);
+    quint64 cross = (lowLow >> 32) + (highLow & 0xFFFFFFFFULL) + lowHigh;
+    quint64 upper = (highLow >> 32) + (cross >> 32) + highHigh;
+    quint64 lower = (cross << 32) | (lowLow & 0xFFFFFFFFULL);
+    return lower ^ upper;
+#endif
+}
+
+inline quint64 avalanche(quint64 hash)
+{
+    hash ^= hash >> 37;
+    hash *= prime64b;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// --- Row blocks of about 1 MiB, each hashed on its own thread ---
+class ParallelRowBlocks : public cv::ParallelLoopBody
+{
+public:
+    ParallelRowBlocks(const cv::Mat& inputImage, int rowsPerBlock, std::vector<quint64>& blockHashes)
+        : image(inputImage), blockRows(rowsPerBlock), hashes(blockHashes) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int block=range.start; block < range.end; block++)
+        {
+            int first = block * blockRows;
+            int last = std::min(image.rows, first + blockRows);
+
+            ImageHash state(static_cast<quint64>(block));
+            state.update(image.rowRange(first, last));
+            hashes[block] = state.digest();
+        }
+    }
+
+private:
+    const cv::Mat& image;
+    int blockRows;
+    std::vector<quint64>& hashes;
+};
+
+class ParallelTileHashes : public cv::ParallelLoopBody
+{
+public:
+    ParallelTileHashes(const cv::Mat& inputImage, int size, std::vector<quint64>& tileHashes)
+        : image(inputImage), tileSize(size), hashes(tileHashes)
+    {
+        across = (image.cols + tileSize - 1) / tileSize;
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int index=range.start; index < range.end; index++)
+        {
+            int x = (index % across) * tileSize;
+            int y = (index / across) * tileSize;
+            cv::Rect rect(x, y, std::min(tileSize, image.cols - x), std::min(tileSize, image.rows - y));
+
+            ImageHash state(static_cast<quint64>(tileSize));
+            state.update(image(rect));
+            hashes[index] = state.digest();
+        }
+    }
+
+private:
+    const cv::Mat& image;
+    int tileSize;
+    int across;
+    std::vector<quint64>& hashes;
+};
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+ImageHash::ImageHash(quint64 seed)
+{
+    const DefaultSecret& base = defaultSecret();
+    for (int index=0; index < 24; index++)
+    {
+        secret[index] = (index & 1) ? base.words[index] - seed : base.words[index] + seed;
+    }
+
+    accumulators[0] = prime32;
+    accumulators[1] = prime64a;
+    accumulators[2] = prime64b;
+    accumulators[3] = 0x85EBCA77C2B2AE63ULL;
+    accumulators[4] = 0x27D4EB2F165667C5ULL;
+    accumulators[5] = 0xC2B2AE3D27D4EB4FULL;
+    accumulators[6] = 0x9E3779B97F4A7C15ULL;
+    accumulators[7] = 0x2545F4914F6CDD1DULL;
+
+    buffered = 0;
+    stripes = 0;
+    totalLength = 0;
+    seedValue = seed;
+}
+
+ImageHash::~ImageHash()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+// --- A partial stripe is zero padded; the length keeps that unambiguous ---
+quint64 ImageHash::digest() const
+{
+    ImageHash state(*this);
+    if (state.buffered > 0)
+    {
+        std::memset(state.buffer + state.buffered, 0, stripeBytes - state.buffered);
+        state.consumeStripe(state.buffer);
+    }
+
+    quint64 result = totalLength * prime64a ^ seedValue;
+    for (int lane=0; lane < 8; lane += 2)
+    {
+        result += multiplyFold(state.accumulators[lane] ^ secret[lane + 3],
+                               state.accumulators[lane + 1] ^ secret[lane + 4]);
+    }
+    return avalanche(result);
+}
+
+// ----- Mutators -------------------------------------------------------------
+void ImageHash::update(const void *data, size_t length)
+{
+    const uchar *bytes = static_cast<const uchar*>(data);
+    totalLength += length;
+
+    if (buffered > 0)
+    {
+        size_t take = std::min(length, stripeBytes - buffered);
+        std::memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        length -= take;
+
+        if (buffered < static_cast<size_t>(stripeBytes))
+        {
+            return;
+        }
+        consumeStripe(buffer);
+        buffered = 0;
+    }
+
+    for (; length >= static_cast<size_t>(stripeBytes); bytes += stripeBytes, length -= stripeBytes)
+    {
+        consumeStripe(bytes);
+    }
+
+    if (length > 0)
+    {
+        std::memcpy(buffer, bytes, length);
+        buffered = length;
+    }
+}
+
+// --- Row by row, so padding and the parent of an ROI are never read ---
+void ImageHash::update(const cv::Mat& image)
+{
+    size_t rowBytes = image.cols * image.elemSize();
+    if (image.isContinuous())
+    {
+        update(image.data, rowBytes * image.rows);
+        return;
+    }
+
+    for (int row=0; row < image.rows; row++)
+    {
+        update(image.ptr(row), rowBytes);
+    }
+}
+
+// --- Accumulate one stripe against the secret, offset by the stripe number ---
+void ImageHash::consumeStripe(const uchar *stripe)
+{
+    const quint64 *key = secret + stripes;
+
+#ifdef IMAGEHASH_SSE2
+    for (int lane=0; lane < 8; lane += 2)
+    {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe + 8 * lane));
+        __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + lane));
+        __m128i mixed = _mm_xor_si128(data, keys);
+        __m128i product = _mm_mul_epu32(mixed, _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+        __m128i *accumulator = reinterpret_cast<__m128i*>(accumulators + lane);
+        _mm_storeu_si128(accumulator, _mm_add_epi64(_mm_loadu_si128(accumulator),
+                                                    _mm_add_epi64(product, swapped)));
+    }
+#else
+    for (int lane=0; lane < 8; lane++)
+    {
+        quint64 data = readWord(stripe + 8 * lane);
+        quint64 mixed = data ^ key[lane];
+        accumulators[lane] += readWord(stripe + 8 * (lane ^ 1));
+        accumulators[lane] += (mixed & 0xFFFFFFFFULL) * (mixed >> 32);
+    }
+#endif
+
+    if (++stripes == stripesPerBlock)
+    {
+        scramble();
+        stripes = 0;
+    }
+}
+
+void ImageHash::scramble()
+{
+    const quint64 *key = secret + 16;
+    for (int lane=0; lane < 8; lane++)
+    {
+        quint64 value = accumulators[lane];
+        value ^= value >> 47;
+        value ^= key[lane];
+        accumulators[lane] = value * prime32;
+    }
+}
+
+// ----- One-shot -------------------------------------------------------------
+quint64 ImageHash::hash(const void *data, size_t length, quint64 seed)
+{
+    ImageHash state(seed);
+    state.update(data, length);
+    return state.digest();
+}
+
+// --- Block hashes are combined with the shape, so equal bytes in another shape differ ---
+quint64 ImageHash::hash(const cv::Mat& image)
+{
+    size_t rowBytes = std::max<size_t>(1, image.cols * image.elemSize());
+    int blockRows = static_cast<int>(std::max<size_t>(1, (size_t(1) << 20) / rowBytes));
+    int blocks = image.rows > 0 ? (image.rows + blockRows - 1) / blockRows : 0;
+
+    std::vector<quint64> blockHashes(blocks);
+    if (blocks > 0)
+    {
+        cv::parallel_for_(cv::Range(0, blocks), ParallelRowBlocks(image, blockRows, blockHashes));
+    }
+
+    int shape[3] = { image.rows, image.cols, image.type() };
+    ImageHash state;
+    state.update(shape, sizeof(shape));
+    if (blocks > 0)
+    {
+        state.update(&blockHashes[0], blockHashes.size() * sizeof(quint64));
+    }
+    return state.digest();
+}
+
+// --- Row-major tiles, the last row and column of tiles possibly smaller ---
+std::vector<quint64> ImageHash::tileHashes(const cv::Mat& image, int tileSize)
+{
+    tileSize = std::max(1, tileSize);
+    int across = (image.cols + tileSize - 1) / tileSize;
+    int down = (image.rows + tileSize - 1) / tileSize;
+
+    std::vector<quint64> hashes(across * down);
+    if (!hashes.empty())
+    {
+        cv::parallel_for_(cv::Range(0, across * down), ParallelTileHashes(image, tileSize, hashes));
+    }
+    return hashes;
+}
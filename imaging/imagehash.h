@@ -0,0 +1,54 @@
+#ifndef IMAGEHASH_H
+#define IMAGEHASH_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include <opencv2/core/core.hpp>
+
+// --- 64-bit content hash in the style of XXH3, for cache keys. ---
+// Input is consumed in 64-byte stripes by eight 64-bit accumulators, each a
+// 32x32->64 multiply of data and secret plus the neighbouring lane, two lanes
+// per SSE2 instruction; every 1 KiB the accumulators are scrambled. The
+// result depends only on the bytes fed, not on how they are split, so a Mat
+// hashes its rows without the row padding and a tile hashes its row segments
+// in place. Whole images hash in row blocks on every core. Not a
+// cryptographic hash: a collision costs a wrong cache hit, so keys should
+// also carry the image size and type.
+class ImageHash
+{
+public:
+    // --- Constructor / Destructor ---
+    explicit ImageHash(quint64 seed = 0);
+    ~ImageHash();
+
+    // --- Accessors ---
+    quint64 digest() const;
+
+    // --- Mutators ---
+    void update(const void *data, size_t length);
+    void update(const cv::Mat& image);
+
+    // --- One-shot ---
+    static quint64 hash(const void *data, size_t length, quint64 seed = 0);
+    static quint64 hash(const cv::Mat& image);
+    static std::vector<quint64> tileHashes(const cv::Mat& image, int tileSize);
+
+private:
+    static const int stripeBytes = 64;
+    static const int stripesPerBlock = 16;
+
+    quint64 accumulators[8];
+    quint64 secret[24];
+    uchar buffer[stripeBytes];
+    size_t buffered;
+    int stripes;
+    quint64 totalLength;
+    quint64 seedValue;
+
+    void consumeStripe(const uchar *stripe);
+    void scramble();
+};
+
+#endif // IMAGEHASH_H
@@ -2,7 +2,40 @@ INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
 SOURCES += \
+    $$PWD/adjustmentchain.cpp \
+    $$PWD/adjustmentpreset.cpp \
+    $$PWD/batchpipeline.cpp \
+    $$PWD/bufferpool.cpp \
+    $$PWD/colorlut3d.cpp \
+    $$PWD/colortables.cpp \
+    $$PWD/framesequence.cpp \
+    $$PWD/imagehash.cpp \
+    $$PWD/imageexporter.cpp \
     $$PWD/myimage.cpp \
+    $$PWD/pngwriter.cpp \
+    $$PWD/resultcache.cpp \
+    $$PWD/selectionmask.cpp \
+    $$PWD/sequencepipeline.cpp \
+    $$PWD/temporaltilecache.cpp \
+    $$PWD/tiledimagefile.cpp \
+    $$PWD/viewportrenderer.cpp \
 
 HEADERS += \
+    $$PWD/adjustmentchain.h \
+    $$PWD/adjustmentpreset.h \
+    $$PWD/batchpipeline.h \
+    $$PWD/boundedqueue.h \
+    $$PWD/bufferpool.h \
+    $$PWD/colorlut3d.h \
+    $$PWD/colortables.h \
+    $$PWD/framesequence.h \
+    $$PWD/imagehash.h \
+    $$PWD/imageexporter.h \
     $$PWD/myimage.h \
+    $$PWD/pngwriter.h \
+    $$PWD/resultcache.h \
+    $$PWD/selectionmask.h \
+    $$PWD/sequencepipeline.h \
+    $$PWD/temporaltilecache.h \
+    $$PWD/tiledimagefile.h \
+    $$PWD/viewportrenderer.h \
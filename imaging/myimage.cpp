@@ -1,9 +1,22 @@
 #include "myimage.h"
 
+#include "colortables.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 // ----- Constructor / Destructor ---------------------------------------------
 MyImage::MyImage(QString input)
 {
     qTitle = input;
+    channelMapped = true;
+    linearLight = false;
+    statistics = statisticsFromHistogram(histogram);
+    invalidateHash();
+
+    // --- Buffers freed by one edit are recycled by the next ---
+    BufferPool::adopt(image);
 }
 
 MyImage::~MyImage()
@@ -13,24 +26,36 @@ MyImage::~MyImage()
 
 // ----- Accessors ------------------------------------------------------------
 // --- Get QImage conversion from OpenCV image to use in the GUI
+// The converted pixels are written straight into a cached QImage, so repeated
+// calls at the same size allocate nothing once the previous copy is released.
 QImage MyImage::getQImage()
 {
-    cv::Mat tmp;
-    cv::cvtColor(image, tmp, CV_BGR2RGB);
+    if (displayImage.width() != image.cols
+            || displayImage.height() != image.rows)
+    {
+        displayImage = QImage(image.cols, image.rows, QImage::Format_RGB888);
+    }
 
-    QImage dest((const uchar *)
-                tmp.data,
-                tmp.cols,
-                tmp.rows,
-                tmp.step,
-                QImage::Format_RGB888);
-    dest.bits();
-    return dest;
+    cv::Mat dest(displayImage.height(),
+                 displayImage.width(),
+                 CV_8UC3,
+                 displayImage.bits(),
+                 displayImage.bytesPerLine());
+    cv::cvtColor(image, dest, CV_BGR2RGB);
+
+    return displayImage;
 }
 
 // --- Save the OpenCV image to a PNG file
+// 8-bit images go through the strip-parallel writer, anything else to imwrite.
 void MyImage::saveImageToPNG(QString outputPath)
 {
+    if (PngWriter::isSupported(image))
+    {
+        PngWriter::write(outputPath, image, 3);
+        return;
+    }
+
     std::vector<int> compression_parameters;
     compression_parameters.push_back(cv::IMWRITE_PNG_COMPRESSION);
     compression_parameters.push_back(3);
@@ -38,52 +63,228 @@ void MyImage::saveImageToPNG(QString outputPath)
     cv::imwrite(outputPath.toStdString(), image, compression_parameters);
 }
 
+// --- Save the OpenCV image as a tiled LZ4 work file, lossless at any depth ---
+bool MyImage::saveImageToTiled(QString outputPath)
+{
+    return TiledImageFile::save(outputPath, image);
+}
+
+// --- RGB to HSI, hue as a fraction of a full turn ---
+void MyImage::rgbToHSI(double R, double G, double B,
+                       double& H, double& S, double& I)
+{
+    const double PI = ColorTables::PI;
+    double theta, tmpNum, tmpDen, tmpMin;
+
+    tmpNum = (R - G) + (R - B);
+    tmpDen = (R - G) * (R - G) + (R - B) * (G - B);
+
+    // --- Hue is undefined for grays, report it as zero ---
+    theta = 0.0;
+    if (tmpDen > 0.0)
+    {
+        theta = acos(std::max(-1.0, std::min(1.0, 0.5 * tmpNum / sqrt(tmpDen))));
+    }
+
+    if (B > G)
+    {
+        H = 2.0 * PI - theta;
+        tmpMin = G;
+    }
+    else
+    {
+        H = theta;
+        tmpMin = B;
+    }
+    if (R < tmpMin)
+    {
+        tmpMin = R;
+    }
+
+    H /= (2.0 * PI);
+    I = (1.0 / 3.0) * (R + G + B);
+    S = (I > 0.0) ? 1.0 - ( 3.0 / (R + G + B)) * tmpMin : 0.0;
+}
+
+// --- HSI to RGB, one 120 degree sector at a time ---
+void MyImage::hsiToRGB(double H, double S, double I,
+                       double& R, double& G, double& B)
+{
+    const double PI = ColorTables::PI;
+    const double angle1 = 0.0;
+    const double angle2 = (1.0/3.0) * 2.0 * PI;
+    const double angle3 = angle2 * 2.0;
+
+    H *= (2.0 * PI);
+
+    if (angle1 <= H && H < angle2)
+    {
+        H -= angle1;
+        B = I * (1.0 - S);
+        R = I * (1.0 + S * ColorTables::cosine(H) / ColorTables::cosine(angle2 / 2.0 - H));
+        G = 3.0 * I - (R + B);
+    }
+    else if (angle2 <= H && H < angle3)
+    {
+        H -= angle2;
+        R = I * (1.0 - S);
+        G = I * (1.0 + S * ColorTables::cosine(H) / ColorTables::cosine(angle2 / 2.0 - H));
+        B = 3.0 * I - (R + G);
+    }
+    else
+    {
+        H -= angle3;
+        G = I * (1.0 - S);
+        B = I * (1.0 + S * ColorTables::cosine(H) / ColorTables::cosine(angle2 / 2.0 - H));
+        R = 3.0 * I - (G + B);
+    }
+}
+
+// --- Hash of the pixels, recomputed only after the image changes ---
+// Every mutator below invalidates it, and another buffer, size or type
+// assigned to image is noticed as well. Code that writes into image's pixels
+// directly must call invalidateHash() itself.
+quint64 MyImage::contentHash()
+{
+    if (!hashValid || hashedData != image.data
+            || hashedSize != image.size() || hashedType != image.type())
+    {
+        cachedHash = ImageHash::hash(image);
+        cachedTileSize = 0;
+        cachedTileHashes.clear();
+        hashedData = image.data;
+        hashedSize = image.size();
+        hashedType = image.type();
+        hashValid = true;
+    }
+    return cachedHash;
+}
+
+// --- Row-major tile hashes, as ImageHash::tileHashes, cached per tile size ---
+const std::vector<quint64>& MyImage::tileHashes(int tileSize)
+{
+    contentHash();
+    if (cachedTileSize != tileSize)
+    {
+        cachedTileHashes = ImageHash::tileHashes(image, tileSize);
+        cachedTileSize = tileSize;
+    }
+    return cachedTileHashes;
+}
+
 // ----- Mutators -------------------------------------------------------------
+void MyImage::invalidateHash()
+{
+    hashValid = false;
+    hashedData = 0;
+    cachedTileSize = 0;
+    cachedTileHashes.clear();
+}
+
 // --- Set image to data read from file ---
 void MyImage::setImage(QString filePath)
 {
-    cv::destroyAllWindows();
-    image.release();
-    image = cv::imread(filePath.toStdString(), intensityColorMap);
+    setImage(filePath, -1);
 }
 
 // --- Set image to data read from default file or to default flat intensity ---
+// Decoding into the existing Mat keeps its pooled allocator, and the encoded
+// bytes are read into a buffer reused across loads. Tiled work files (.ict)
+// are mapped and their tiles decoded straight into the image. A file that
+// cannot be read or decoded leaves the image empty, never the previous one.
 void MyImage::setImage(QString filePath, int intensityValue)
 {
-    if(intensityValue<0) {
+    invalidateHash();
+    channelLUT.release();
+    channelMapped = true;
+
+    if(intensityValue<0 && TiledImageFile::isTiledFile(filePath)) {
+        if(!TiledImageFile::load(filePath, image)) {
+            image.release();
+        }
+    }
+    else if(intensityValue<0) {
         QFile file(filePath);
         cv::destroyAllWindows();
-        image.release();
 
         if(file.open(QIODevice::ReadOnly)) {
             qint64 imageFileSize = file.size();
-            std::vector<uchar> buf(imageFileSize);
-
-            file.read((char*)buf.data(), imageFileSize);
+            fileBuffer.resize(imageFileSize);
 
-            image = cv::imdecode(buf,intensityColorMap);
+            // --- imdecode leaves image untouched when no decoder matches ---
+            image.release();
+            if(imageFileSize > 0 && file.read((char*)fileBuffer.data(), imageFileSize) == imageFileSize) {
+                cv::imdecode(fileBuffer, intensityColorMap, &image);
+            }
+        }
+        else {
+            image.release();
         }
     }
     else {
-        image.release();
-        image = cv::Mat::ones(256, 512, CV_32FC3) * intensityValue;
+        image.create(256, 512, CV_32FC3);
+        image.setTo(cv::Scalar::all(intensityValue));
     }
 }
 
-// --- ---
-void MyImage::adjustRGB(const cv::Mat& inputImage, int colorCode, double colorScale)
+// --- Build a per-channel lookup table (BGR order) from RGB gains ---
+// In linear mode each entry is decoded from sRGB, scaled and re-encoded, so
+// the extra accuracy is folded into the table and the pixel pass is unchanged.
+cv::Mat MyImage::buildChannelLUT(double redScale,
+                                 double greenScale,
+                                 double blueScale,
+                                 bool linear)
 {
-    for (int row=0; row < inputImage.rows; row++)
+    cv::Mat lut(1, histogramBins, CV_8UC3);
+    const double scale[3] = { blueScale, greenScale, redScale };
+
+    cv::Vec3b *entry = lut.ptr<cv::Vec3b>(0);
+    for (int value=0; value < histogramBins; value++)
     {
-        for (int col=0; col < inputImage.cols; col++)
+        for (int channel=0; channel < 3; channel++)
         {
-            cv::Vec3b color = inputImage.at<cv::Vec3b>(row,col);
+            if (linear)
+            {
+                float light = ColorTables::srgbToLinear(value) * scale[channel];
+                entry[value][channel] = ColorTables::linearToSRGB(light);
+            }
+            else
+            {
+                // truncate like the scalar uchar *= double this replaces
+                double mapped = std::min(255.0, value * scale[channel]);
+                entry[value][channel] = static_cast<uchar>(mapped);
+            }
+        }
+    }
+    return lut;
+}
 
-            color[colorCode] *= colorScale;
+// --- Build a per-channel table stretching [low, high] onto [0, 255] ---
+cv::Mat MyImage::buildLevelsLUT(const int low[3], const int high[3])
+{
+    cv::Mat lut(1, histogramBins, CV_8UC3);
+
+    cv::Vec3b *entry = lut.ptr<cv::Vec3b>(0);
+    for (int channel=0; channel < 3; channel++)
+    {
+        double range = std::max(1, high[channel] - low[channel]);
 
-            image.at<cv::Vec3b>(row,col) = color;
+        for (int value=0; value < histogramBins; value++)
+        {
+            double mapped = 255.0 * (value - low[channel]) / range;
+            entry[value][channel] = cv::saturate_cast<uchar>(mapped);
         }
     }
+    return lut;
+}
+
+// --- Scale a single channel, leaving the other two as in the input ---
+void MyImage::adjustRGB(const cv::Mat& inputImage, int colorCode, double colorScale)
+{
+    double scale[3] = { 1.0, 1.0, 1.0 };
+    scale[colorCode] = colorScale;
+
+    adjustRGB(inputImage, scale[2], scale[1], scale[0]);
 }
 
 void MyImage::adjustRGB(const cv::Mat& inputImage,
@@ -91,25 +292,611 @@ void MyImage::adjustRGB(const cv::Mat& inputImage,
                         double greenScale,
                         double blueScale)
 {
-    for (int row=0; row < inputImage.rows; row++)
+    if (inputImage.depth() == CV_32F)
     {
-        for (int col=0; col < inputImage.cols; col++)
+        applyFloatGains(inputImage, redScale, greenScale, blueScale);
+        return;
+    }
+
+    applyChannelLUT(inputImage, buildChannelLUT(redScale,
+                                                greenScale,
+                                                blueScale,
+                                                linearLight));
+}
+
+void MyImage::adjustRGB(const cv::Mat& inputImage,
+                        double redScale,
+                        double greenScale,
+                        double blueScale,
+                        const SelectionMask& selection)
+{
+    if (inputImage.depth() == CV_32F)
+    {
+        applyFloatGains(inputImage, redScale, greenScale, blueScale);
+        return;
+    }
+
+    applyChannelLUT(inputImage, buildChannelLUT(redScale,
+                                                greenScale,
+                                                blueScale,
+                                                linearLight), selection);
+}
+
+// --- Frames too large for the last-level cache are written with streaming stores ---
+namespace {
+
+const size_t streamingThresholdBytes = size_t(32) * 1024 * 1024;
+
+class StreamingLUTStripes : public cv::ParallelLoopBody
+{
+public:
+    StreamingLUTStripes(const cv::Mat& inputImage,
+                        cv::Mat& outputImage,
+                        const cv::Mat& channelTable)
+        : input(inputImage), output(outputImage), table(channelTable.ptr<uchar>(0)) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        const size_t count = 3 * size_t(input.cols);
+
+        for (int row=range.start; row < range.end; row++)
         {
-            cv::Vec3b color = inputImage.at<cv::Vec3b>(row,col);
-            color[2] *= redScale;
-            color[1] *= greenScale;
-            color[0] *= blueScale;
+            const uchar *source = input.ptr<uchar>(row);
+            uchar *target = output.ptr<uchar>(row);
+            size_t index = 0;
+            int channel = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+            // --- Scalar head until the target is 16-byte aligned ---
+            while (index < count && (reinterpret_cast<size_t>(target + index) & 15))
+            {
+                target[index] = table[3 * source[index] + channel];
+                channel = (channel == 2) ? 0 : channel + 1;
+                index++;
+            }
 
-            image.at<cv::Vec3b>(row,col) = color;
+            // --- Gather 16 bytes, then store them bypassing the cache ---
+            CV_DECL_ALIGNED(16) uchar block[16];
+            for (; index + 16 <= count; index += 16)
+            {
+                for (int k=0; k < 16; k++)
+                {
+                    block[k] = table[3 * source[index + k] + channel];
+                    channel = (channel == 2) ? 0 : channel + 1;
+                }
+                _mm_stream_si128(reinterpret_cast<__m128i*>(target + index),
+                                 _mm_load_si128(reinterpret_cast<const __m128i*>(block)));
+            }
+#endif
+            for (; index < count; index++)
+            {
+                target[index] = table[3 * source[index] + channel];
+                channel = (channel == 2) ? 0 : channel + 1;
+            }
         }
+#if defined(__SSE2__) || defined(_M_X64)
+        _mm_sfence();
+#endif
     }
+
+private:
+    const cv::Mat& input;
+    cv::Mat& output;
+    const uchar *table;
+};
+
 }
 
+// --- Remap every pixel through a per-channel table, remembering the table ---
+void MyImage::applyChannelLUT(const cv::Mat& inputImage, const cv::Mat& lut)
+{
+    invalidateHash();
+    channelLUT = lut;
+    channelMapped = true;
 
+    size_t bytes = inputImage.total() * inputImage.elemSize();
+    if (bytes < streamingThresholdBytes
+            || inputImage.type() != CV_8UC3
+            || inputImage.data == image.data)
+    {
+        cv::LUT(inputImage, channelLUT, image);
+        return;
+    }
 
+    image.create(inputImage.size(), inputImage.type());
+    cv::parallel_for_(cv::Range(0, inputImage.rows),
+                      StreamingLUTStripes(inputImage, image, channelLUT));
+}
 
+namespace {
 
+// --- One selection tile per index ---
+class MaskedLUTTiles : public cv::ParallelLoopBody
+{
+public:
+    MaskedLUTTiles(const cv::Mat& inputImage,
+                   cv::Mat& outputImage,
+                   const cv::Mat& channelTable,
+                   const SelectionMask& mask)
+        : input(inputImage), output(outputImage), table(channelTable), selection(mask)
+    {
+        across = (input.cols + SelectionMask::tileSize - 1) / SelectionMask::tileSize;
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        const int size = SelectionMask::tileSize;
+        for (int index=range.start; index < range.end; index++)
+        {
+            cv::Rect rect((index % across) * size, (index / across) * size, size, size);
+            MyImage::applyChannelLUTRect(input, output, table, selection, rect);
+        }
+    }
+
+private:
+    const cv::Mat& input;
+    cv::Mat& output;
+    const cv::Mat& table;
+    const SelectionMask& selection;
+    int across;
+};
+
+}
+
+// --- Map one region of a preallocated output: copy, map, or map and blend ---
+// rect should start on the selection tile grid; it is clipped to the image.
+// Without a selection every tile counts as fully selected.
+void MyImage::applyChannelLUTRect(const cv::Mat& inputImage,
+                                  cv::Mat& outputImage,
+                                  const cv::Mat& lut,
+                                  const SelectionMask& selection,
+                                  cv::Rect rect)
+{
+    cv::Rect image(0, 0, inputImage.cols, inputImage.rows);
+    rect &= image;
+    if (selection.isEmpty() || selection.size() != inputImage.size()
+            || inputImage.type() != CV_8UC3)
+    {
+        cv::Mat target = outputImage(rect);
+        cv::LUT(inputImage(rect), lut, target);
+        return;
+    }
+
+    const int size = SelectionMask::tileSize;
+    const uchar *table = lut.ptr<uchar>(0);
+
+    for (int y=rect.y; y < rect.y + rect.height; y += size)
+    {
+        for (int x=rect.x; x < rect.x + rect.width; x += size)
+        {
+            cv::Rect tile = cv::Rect(x, y, size, size) & rect;
+            cv::Mat source = inputImage(tile);
+            cv::Mat target = outputImage(tile);
+
+            switch (selection.coverage(x / size, y / size))
+            {
+            case SelectionMask::EmptyTile:
+                if (source.data != target.data)
+                {
+                    source.copyTo(target);
+                }
+                break;
+
+            case SelectionMask::FullTile:
+                cv::LUT(source, lut, target);
+                break;
+
+            default:
+                for (int row=0; row < tile.height; row++)
+                {
+                    const uchar *pixel = source.ptr<uchar>(row);
+                    const uchar *weight = selection.weights().ptr<uchar>(tile.y + row) + tile.x;
+                    uchar *result = target.ptr<uchar>(row);
+
+                    for (int column=0; column < tile.width; column++, pixel += 3, result += 3)
+                    {
+                        int w = weight[column];
+                        for (int channel=0; channel < 3; channel++)
+                        {
+                            int before = pixel[channel];
+                            int after = table[3 * before + channel];
+                            result[channel] = static_cast<uchar>(before + ((after - before) * w + 127) / 255);
+                        }
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
 
+// --- Only the selection is mapped; inputImage may be image ---
+// Unselected tiles are copied (or left alone when working in place), fully
+// selected tiles take the plain table pass and only tiles on the feathered
+// edge blend per pixel. The result is no longer a per-channel map of the
+// source, so the histogram is rescanned.
+void MyImage::applyChannelLUT(const cv::Mat& inputImage,
+                              const cv::Mat& lut,
+                              const SelectionMask& selection)
+{
+    if (selection.isEmpty() || selection.size() != inputImage.size()
+            || inputImage.type() != CV_8UC3)
+    {
+        applyChannelLUT(inputImage, lut);
+        return;
+    }
+
+    invalidateHash();
+    channelLUT.release();
+    channelMapped = false;
 
+    if (inputImage.data != image.data)
+    {
+        image.create(inputImage.size(), inputImage.type());
+    }
+
+    int across = (inputImage.cols + SelectionMask::tileSize - 1) / SelectionMask::tileSize;
+    int down = (inputImage.rows + SelectionMask::tileSize - 1) / SelectionMask::tileSize;
+    cv::parallel_for_(cv::Range(0, across * down),
+                      MaskedLUTTiles(inputImage, image, lut, selection));
+}
 
+// --- Float images (0..1): decode, scale and encode fused in one pass ---
+namespace {
 
+class FloatGainStripes : public cv::ParallelLoopBody
+{
+public:
+    FloatGainStripes(const cv::Mat& inputImage,
+                     cv::Mat& outputImage,
+                     const float gains[3],
+                     bool linearLight)
+        : input(inputImage), output(outputImage), linear(linearLight)
+    {
+        scale[0] = gains[0];
+        scale[1] = gains[1];
+        scale[2] = gains[2];
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int row=range.start; row < range.end; row++)
+        {
+            const float *source = input.ptr<float>(row);
+            float *target = output.ptr<float>(row);
+
+            for (int index=0; index < 3 * input.cols; index += 3)
+            {
+                for (int channel=0; channel < 3; channel++)
+                {
+                    float value = source[index + channel];
+                    if (linear)
+                    {
+                        value = ColorTables::srgbToLinearFloat(value) * scale[channel];
+                        value = ColorTables::linearToSRGBFloat(value);
+                    }
+                    else
+                    {
+                        value *= scale[channel];
+                    }
+                    target[index + channel] = value;
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat& input;
+    cv::Mat& output;
+    float scale[3];
+    bool linear;
+};
+
+}
+
+void MyImage::applyFloatGains(const cv::Mat& inputImage,
+                              double redScale,
+                              double greenScale,
+                              double blueScale)
+{
+    CV_Assert(inputImage.type() == CV_32FC3);
+
+    const float scale[3] = { float(blueScale), float(greenScale), float(redScale) };
+
+    invalidateHash();
+    channelLUT.release();
+    channelMapped = false;
+    image.create(inputImage.size(), inputImage.type());
+
+    cv::parallel_for_(cv::Range(0, inputImage.rows),
+                      FloatGainStripes(inputImage, image, scale, linearLight));
+}
+
+// --- Cross-channel mapping, the output histogram has to be rescanned ---
+void MyImage::applyLUT3D(const cv::Mat& inputImage, const ColorLUT3D& lut)
+{
+    invalidateHash();
+    channelLUT.release();
+    channelMapped = false;
+    lut.apply(inputImage, image);
+}
+
+// --- Any depth of chain costs one table interpolation per pixel ---
+void MyImage::applyChain(const cv::Mat& inputImage,
+                         const AdjustmentChain& chain,
+                         int points)
+{
+    applyLUT3D(inputImage, chain.bake(points));
+}
+
+// --- Run whichever kernel the preset compiled to; inputImage may be image ---
+// Passing image itself adjusts it in place, one read and one write per pixel
+// and no second frame; the batch, sequence and daemon paths all do that.
+void MyImage::applyPreset(const cv::Mat& inputImage, const CompiledPreset& preset)
+{
+    switch (preset.kernel)
+    {
+    case CompiledPreset::ChannelKernel:
+        applyChannelLUT(inputImage, preset.channelLUT);
+        break;
+
+    case CompiledPreset::Table3DKernel:
+        applyLUT3D(inputImage, preset.lut);
+        break;
+
+    default:
+        if (inputImage.data != image.data)
+        {
+            inputImage.copyTo(image);
+            invalidateHash();
+        }
+        channelLUT.release();
+        channelMapped = true;
+        break;
+    }
+}
+
+// ----- Automatic Corrections ------------------------------------------------
+// --- Each is one statistics pass over the input plus one table lookup pass ---
+void MyImage::autoWhiteBalanceGrayWorld(const cv::Mat& inputImage)
+{
+    ImageStatistics stats = measureStatistics(inputImage);
+    double gray = (stats.mean[0] + stats.mean[1] + stats.mean[2]) / 3.0;
+    double scale[3];
+
+    for (int channel=0; channel < 3; channel++)
+    {
+        scale[channel] = (stats.mean[channel] > 0.0) ? gray / stats.mean[channel] : 1.0;
+    }
+
+    applyChannelLUT(inputImage, buildChannelLUT(scale[2], scale[1], scale[0]));
+}
+
+void MyImage::autoWhiteBalanceWhitePatch(const cv::Mat& inputImage,
+                                         double highFraction)
+{
+    ImageStatistics stats = measureStatistics(inputImage, 0.0, highFraction);
+    double scale[3];
+
+    for (int channel=0; channel < 3; channel++)
+    {
+        int white = stats.percentileHigh[channel];
+        scale[channel] = (white > 0) ? 255.0 / white : 1.0;
+    }
+
+    applyChannelLUT(inputImage, buildChannelLUT(scale[2], scale[1], scale[0]));
+}
+
+void MyImage::autoLevels(const cv::Mat& inputImage,
+                         double lowFraction,
+                         double highFraction)
+{
+    ImageStatistics stats = measureStatistics(inputImage, lowFraction, highFraction);
+
+    applyChannelLUT(inputImage, buildLevelsLUT(stats.percentileLow,
+                                               stats.percentileHigh));
+}
+
+// ----- Histograms and Statistics -------------------------------------------
+namespace {
+
+const int histogramStripeRows = 64;
+
+// --- Counts one stripe of rows per task into its own partial histogram ---
+class HistogramStripes : public cv::ParallelLoopBody
+{
+public:
+    HistogramStripes(const cv::Mat& inputImage, std::vector<int>& partialCounts)
+        : image(inputImage), counts(partialCounts) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        const int bins = MyImage::histogramBins;
+
+        for (int stripe=range.start; stripe < range.end; stripe++)
+        {
+            int *countB = &counts[stripe * 3 * bins];
+            int *countG = countB + bins;
+            int *countR = countG + bins;
+
+            int rowEnd = std::min(image.rows, (stripe + 1) * histogramStripeRows);
+            for (int row=stripe * histogramStripeRows; row < rowEnd; row++)
+            {
+                const uchar *pixel = image.ptr<uchar>(row);
+                const uchar *pixelEnd = pixel + 3 * image.cols;
+
+                for (; pixel != pixelEnd; pixel += 3)
+                {
+                    countB[pixel[0]]++;
+                    countG[pixel[1]]++;
+                    countR[pixel[2]]++;
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat& image;
+    std::vector<int>& counts;
+};
+
+}
+
+// --- Parallel pass over the image, counting all three channels at once ---
+QVector< QVector<int> > MyImage::measureHistogram(const cv::Mat& inputImage)
+{
+    QVector< QVector<int> > result(3, QVector<int>(histogramBins, 0));
+
+    if (inputImage.empty() || inputImage.type() != CV_8UC3)
+    {
+        return result;
+    }
+
+    int stripes = (inputImage.rows + histogramStripeRows - 1) / histogramStripeRows;
+    std::vector<int> partialCounts(stripes * 3 * histogramBins, 0);
+
+    cv::parallel_for_(cv::Range(0, stripes),
+                      HistogramStripes(inputImage, partialCounts));
+
+    // --- Merge the stripes, O(stripes * bins) ---
+    for (int stripe=0; stripe < stripes; stripe++)
+    {
+        const int *partial = &partialCounts[stripe * 3 * histogramBins];
+        for (int channel=0; channel < 3; channel++)
+        {
+            int *merged = result[channel].data();
+            for (int bin=0; bin < histogramBins; bin++)
+            {
+                merged[bin] += partial[channel * histogramBins + bin];
+            }
+        }
+    }
+    return result;
+}
+
+// --- Means and percentiles follow exactly from the histogram, O(bins) ---
+ImageStatistics MyImage::statisticsFromHistogram(
+        const QVector< QVector<int> >& inputHistogram,
+        double lowFraction,
+        double highFraction)
+{
+    ImageStatistics result;
+    result.pixelCount = 0;
+
+    for (int channel=0; channel < 3; channel++)
+    {
+        result.mean[channel] = 0.0;
+        result.percentileLow[channel] = 0;
+        result.percentileHigh[channel] = histogramBins - 1;
+    }
+
+    if (inputHistogram.size() == 3)
+    {
+        for (int bin=0; bin < inputHistogram[0].size(); bin++)
+        {
+            result.pixelCount += inputHistogram[0][bin];
+        }
+    }
+
+    if (result.pixelCount > 0)
+    {
+        for (int channel=0; channel < 3; channel++)
+        {
+            const QVector<int>& counts = inputHistogram[channel];
+            double lowCount = lowFraction * result.pixelCount;
+            double highCount = highFraction * result.pixelCount;
+            double sum = 0.0;
+            qint64 cumulative = 0;
+            bool lowFound = false;
+            bool highFound = false;
+
+            for (int bin=0; bin < counts.size(); bin++)
+            {
+                sum += 1.0 * bin * counts[bin];
+                cumulative += counts[bin];
+
+                if (!lowFound && cumulative >= lowCount)
+                {
+                    result.percentileLow[channel] = bin;
+                    lowFound = true;
+                }
+                if (!highFound && cumulative >= highCount)
+                {
+                    result.percentileHigh[channel] = bin;
+                    highFound = true;
+                }
+            }
+            result.mean[channel] = sum / result.pixelCount;
+        }
+    }
+
+    rgbToHSI(result.mean[2] / 255.0,
+             result.mean[1] / 255.0,
+             result.mean[0] / 255.0,
+             result.hue,
+             result.saturation,
+             result.intensity);
+    return result;
+}
+
+ImageStatistics MyImage::measureStatistics(const cv::Mat& inputImage,
+                                           double lowFraction,
+                                           double highFraction)
+{
+    return statisticsFromHistogram(measureHistogram(inputImage),
+                                   lowFraction,
+                                   highFraction);
+}
+
+void MyImage::computeHistogram()
+{
+    histogram = measureHistogram(image);
+}
+
+void MyImage::computeStatistics()
+{
+    computeHistogram();
+    statistics = statisticsFromHistogram(histogram);
+}
+
+// --- Remap a source histogram through channelLUT, O(bins) per channel ---
+void MyImage::deriveHistogram(const QVector< QVector<int> >& sourceHistogram)
+{
+    histogram = QVector< QVector<int> >(3, QVector<int>(histogramBins, 0));
+
+    if (sourceHistogram.size() != 3)
+    {
+        return;
+    }
+
+    if (channelLUT.empty())
+    {
+        histogram = sourceHistogram;
+        return;
+    }
+
+    const cv::Vec3b *entry = channelLUT.ptr<cv::Vec3b>(0);
+    for (int channel=0; channel < 3; channel++)
+    {
+        const int *source = sourceHistogram[channel].constData();
+        int *derived = histogram[channel].data();
+
+        for (int value=0; value < histogramBins; value++)
+        {
+            derived[entry[value][channel]] += source[value];
+        }
+    }
+}
+
+// --- Derive from the source when the mapping allows it, otherwise rescan ---
+void MyImage::updateHistogram(const QVector< QVector<int> >& sourceHistogram)
+{
+    if (channelMapped)
+    {
+        deriveHistogram(sourceHistogram);
+    }
+    else
+    {
+        computeHistogram();
+    }
+}
@@ -1,8 +1,10 @@
 #ifndef MYIMAGE_H
 #define MYIMAGE_H
 
+#include <algorithm>
 #include <iostream>
 #include <math.h>
+#include <vector>
 
 #include <QFile>
 #include <QImage>
@@ -13,10 +15,42 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "adjustmentchain.h"
+#include "adjustmentpreset.h"
+#include "bufferpool.h"
+#include "colorlut3d.h"
+#include "imagehash.h"
+#include "pngwriter.h"
+#include "selectionmask.h"
+#include "tiledimagefile.h"
+
+// --- Summary of image content, channels in BGR order like cv::Mat ---
+struct ImageStatistics
+{
+    qint64 pixelCount;
+    double mean[3];         // 0..255
+    int percentileLow[3];   // 0..255, lowFraction of pixels at or below
+    int percentileHigh[3];  // 0..255, highFraction of pixels at or below
+    double hue;             // 0..1, of the mean color
+    double saturation;      // 0..1, of the mean color
+    double intensity;       // 0..1, of the mean color
+};
+
 class MyImage
 {
 private:
     QString qTitle;
+    QImage displayImage;            // reused target of getQImage
+    std::vector<uchar> fileBuffer;  // reused encoded bytes for setImage
+
+    // --- Content hash cache, see contentHash() ---
+    bool hashValid;
+    const uchar *hashedData;
+    cv::Size hashedSize;
+    int hashedType;
+    quint64 cachedHash;
+    int cachedTileSize;
+    std::vector<quint64> cachedTileHashes;
 
 public:
     // --- Consructor / Destructor ---
@@ -26,12 +60,50 @@ public:
     // --- OpenCV members ---
     static const int intensityColorMap = cv::IMREAD_COLOR;
     cv::Mat image;
+    cv::Mat channelLUT; // 1x256 CV_8UC3, last per-channel mapping applied
+    bool channelMapped; // image is channelLUT applied to its source
+    bool linearLight;   // adjustRGB scales linear light instead of sRGB codes
+
+    // --- Histogram members ---
+    static const int histogramBins = 256;
+    QVector< QVector<int> > histogram; // [channel][bin], BGR like image
+    ImageStatistics statistics;
 
     // --- Accessors ---
     QImage getQImage();
     void saveImageToPNG(QString outputPath);
+    bool saveImageToTiled(QString outputPath);
+    quint64 contentHash();
+    const std::vector<quint64>& tileHashes(int tileSize);
+    static cv::Mat buildChannelLUT(double redScale,
+                                   double greenScale,
+                                   double blueScale,
+                                   bool linear = false);
+    static cv::Mat buildLevelsLUT(const int low[3],
+                                  const int high[3]);
+    static void applyChannelLUTRect(const cv::Mat& inputImage,
+                                    cv::Mat& outputImage,
+                                    const cv::Mat& lut,
+                                    const SelectionMask& selection,
+                                    cv::Rect rect);
+
+    static QVector< QVector<int> > measureHistogram(const cv::Mat& inputImage);
+    static ImageStatistics measureStatistics(const cv::Mat& inputImage,
+                                             double lowFraction = 0.01,
+                                             double highFraction = 0.99);
+    static ImageStatistics statisticsFromHistogram(
+            const QVector< QVector<int> >& inputHistogram,
+            double lowFraction = 0.01,
+            double highFraction = 0.99);
+
+    // --- Color space conversion, all values normalized to 0..1 ---
+    static void rgbToHSI(double R, double G, double B,
+                         double& H, double& S, double& I);
+    static void hsiToRGB(double H, double S, double I,
+                         double& R, double& G, double& B);
 
     // --- Mutators ---
+    void invalidateHash();
     void setImage(QString filePath);
     void setImage(QString filePath, int intensityValue);
 
@@ -42,6 +114,39 @@ public:
                    double redScale,
                    double greenScale,
                    double blueScale);
+    void adjustRGB(const cv::Mat& inputImage,
+                   double redScale,
+                   double greenScale,
+                   double blueScale,
+                   const SelectionMask& selection);
+    void applyChannelLUT(const cv::Mat& inputImage,
+                         const cv::Mat& lut);
+    void applyChannelLUT(const cv::Mat& inputImage,
+                         const cv::Mat& lut,
+                         const SelectionMask& selection);
+    void applyFloatGains(const cv::Mat& inputImage,
+                         double redScale,
+                         double greenScale,
+                         double blueScale);
+    void applyLUT3D(const cv::Mat& inputImage,
+                    const ColorLUT3D& lut);
+    void applyChain(const cv::Mat& inputImage,
+                    const AdjustmentChain& chain,
+                    int points = 33);
+    void applyPreset(const cv::Mat& inputImage,
+                     const CompiledPreset& preset);
+
+    void autoWhiteBalanceGrayWorld(const cv::Mat& inputImage);
+    void autoWhiteBalanceWhitePatch(const cv::Mat& inputImage,
+                                    double highFraction = 0.99);
+    void autoLevels(const cv::Mat& inputImage,
+                    double lowFraction = 0.01,
+                    double highFraction = 0.99);
+
+    void computeHistogram();
+    void computeStatistics();
+    void deriveHistogram(const QVector< QVector<int> >& sourceHistogram);
+    void updateHistogram(const QVector< QVector<int> >& sourceHistogram);
 };
 
 #endif // MYIMAGE_H
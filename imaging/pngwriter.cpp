@@ -0,0 +1,384 @@
+#include "pngwriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <QFile>
+
+#include <zlib.h>
+
+namespace {
+
+const uchar pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+const size_t windowBytes = 32768;
+
+void appendBigEndian(std::vector<uchar>& buffer, quint32 value)
+{
+    buffer.push_back(static_cast<uchar>(value >> 24));
+    buffer.push_back(static_cast<uchar>(value >> 16));
+    buffer.push_back(static_cast<uchar>(value >> 8));
+    buffer.push_back(static_cast<uchar>(value));
+}
+
+void appendChunk(std::vector<uchar>& buffer, const char type[4], const uchar *data, size_t length)
+{
+    appendBigEndian(buffer, static_cast<quint32>(length));
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    buffer.insert(buffer.end(), type, type + 4);
+
+    if (length > 0)
+    {
+        crc = crc32(crc, data, static_cast<uInt>(length));
+        buffer.insert(buffer.end(), data, data + length);
+    }
+    appendBigEndian(buffer, static_cast<quint32>(crc));
+}
+
+// --- Filter type per row by libpng's heuristic, smallest sum of |residual| ---
+class RowFilterStripes : public cv::ParallelLoopBody
+{
+public:
+    RowFilterStripes(const cv::Mat& inputImage, uchar *filteredData, bool adaptiveFilter)
+        : input(inputImage), filtered(filteredData), adaptive(adaptiveFilter)
+    {
+        channels = input.channels();
+        rowBytes = static_cast<size_t>(input.cols) * channels;
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        std::vector<uchar> previous(rowBytes, 0);
+        std::vector<uchar> current(rowBytes);
+        std::vector<uchar> candidate(rowBytes);
+
+        if (range.start > 0)
+        {
+            toPNGOrder(input.ptr<uchar>(range.start - 1), &previous[0]);
+        }
+
+        for (int row=range.start; row < range.end; row++)
+        {
+            uchar *output = filtered + static_cast<size_t>(row) * (rowBytes + 1);
+            toPNGOrder(input.ptr<uchar>(row), &current[0]);
+
+            // --- Start from no filter, all that level 0 uses, as in libpng ---
+            output[0] = 0;
+            std::memcpy(output + 1, &current[0], rowBytes);
+
+            if (adaptive)
+            {
+                unsigned long best = residualSum(output + 1);
+                for (int type=1; type <= 4; type++)
+                {
+                    applyFilter(type, &current[0], &previous[0], &candidate[0]);
+
+                    unsigned long sum = residualSum(&candidate[0]);
+                    if (sum < best)
+                    {
+                        best = sum;
+                        output[0] = static_cast<uchar>(type);
+                        std::memcpy(output + 1, &candidate[0], rowBytes);
+                    }
+                }
+            }
+            current.swap(previous);
+        }
+    }
+
+private:
+    const cv::Mat& input;
+    uchar *filtered;
+    bool adaptive;
+    int channels;
+    size_t rowBytes;
+
+    // --- PNG stores RGB(A), OpenCV keeps BGR(A) ---
+    void toPNGOrder(const uchar *source, uchar *destination) const
+    {
+        if (channels < 3)
+        {
+            std::memcpy(destination, source, rowBytes);
+            return;
+        }
+        for (size_t index=0; index < rowBytes; index += channels)
+        {
+            destination[index] = source[index + 2];
+            destination[index + 1] = source[index + 1];
+            destination[index + 2] = source[index];
+            if (channels == 4)
+            {
+                destination[index + 3] = source[index + 3];
+            }
+        }
+    }
+
+    void applyFilter(int type, const uchar *row, const uchar *above, uchar *output) const
+    {
+        for (size_t index=0; index < rowBytes; index++)
+        {
+            int left = index >= static_cast<size_t>(channels) ? row[index - channels] : 0;
+            int up = above[index];
+            int corner = index >= static_cast<size_t>(channels) ? above[index - channels] : 0;
+            int predicted = 0;
+
+            switch (type)
+            {
+            case 1:
+                predicted = left;
+                break;
+            case 2:
+                predicted = up;
+                break;
+            case 3:
+                predicted = (left + up) >> 1;
+                break;
+            default:
+            {
+                int estimate = left + up - corner;
+                int toLeft = std::abs(estimate - left);
+                int toUp = std::abs(estimate - up);
+                int toCorner = std::abs(estimate - corner);
+
+                if (toLeft <= toUp && toLeft <= toCorner) predicted = left;
+                else if (toUp <= toCorner) predicted = up;
+                else predicted = corner;
+            }
+            }
+            output[index] = static_cast<uchar>(row[index] - predicted);
+        }
+    }
+
+    unsigned long residualSum(const uchar *row) const
+    {
+        unsigned long sum = 0;
+        for (size_t index=0; index < rowBytes; index++)
+        {
+            sum += row[index] < 128 ? row[index] : 256 - row[index];
+        }
+        return sum;
+    }
+};
+
+// --- One raw deflate stream per strip, joined later by the caller ---
+class DeflateStrips : public cv::ParallelLoopBody
+{
+public:
+    DeflateStrips(const uchar *filteredData,
+                  const std::vector<size_t>& stripOffsets,
+                  int compressionLevel,
+                  std::vector< std::vector<uchar> >& stripOutputs,
+                  std::vector<uLong>& stripChecksums,
+                  std::vector<int>& stripStatus)
+        : filtered(filteredData), offsets(stripOffsets), level(compressionLevel),
+          outputs(stripOutputs), checksums(stripChecksums), status(stripStatus) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int strip=range.start; strip < range.end; strip++)
+        {
+            status[strip] = compress(strip) ? 1 : 0;
+        }
+    }
+
+private:
+    const uchar *filtered;
+    const std::vector<size_t>& offsets;
+    int level;
+    std::vector< std::vector<uchar> >& outputs;
+    std::vector<uLong>& checksums;
+    std::vector<int>& status;
+
+    bool compress(int strip) const
+    {
+        const bool last = strip + 2 == static_cast<int>(offsets.size());
+        const uchar *data = filtered + offsets[strip];
+        const size_t length = offsets[strip + 1] - offsets[strip];
+
+        checksums[strip] = adler32(adler32(0L, Z_NULL, 0), data, static_cast<uInt>(length));
+
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+
+        // --- The decoder's window holds the previous strip, so it may be referenced ---
+        if (strip > 0)
+        {
+            size_t history = std::min(windowBytes, offsets[strip]);
+            deflateSetDictionary(&stream, data - history, static_cast<uInt>(history));
+        }
+
+        // --- The first strip leaves room for the two-byte zlib header ---
+        std::vector<uchar>& output = outputs[strip];
+        size_t used = strip == 0 ? 2 : 0;
+        output.resize(used + deflateBound(&stream, static_cast<uLong>(length)) + 64);
+
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(length);
+
+        const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        for (;;)
+        {
+            stream.next_out = &output[used];
+            stream.avail_out = static_cast<uInt>(output.size() - used);
+
+            int result = deflate(&stream, flush);
+            used = output.size() - stream.avail_out;
+
+            if (result == Z_STREAM_ERROR)
+            {
+                deflateEnd(&stream);
+                return false;
+            }
+            if (last ? result == Z_STREAM_END : stream.avail_out > 0)
+            {
+                break;
+            }
+            output.resize(2 * output.size());
+        }
+
+        output.resize(used);
+        deflateEnd(&stream);
+        return true;
+    }
+};
+
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool PngWriter::isSupported(const cv::Mat& image)
+{
+    int channels = image.channels();
+    return !image.empty() && image.depth() == CV_8U
+            && (channels == 1 || channels == 3 || channels == 4);
+}
+
+// ----- Encoding -------------------------------------------------------------
+bool PngWriter::encode(const cv::Mat& image,
+                       std::vector<uchar>& buffer,
+                       int compression,
+                       int strips)
+{
+    if (!isSupported(image))
+    {
+        return false;
+    }
+
+    const int level = std::max(0, std::min(9, compression));
+    const int channels = image.channels();
+    const size_t lineBytes = static_cast<size_t>(image.cols) * channels + 1;
+
+    // --- Filter every row into one buffer, one filter byte per row ---
+    std::vector<uchar> filtered(lineBytes * image.rows);
+    cv::parallel_for_(cv::Range(0, image.rows),
+                      RowFilterStripes(image, &filtered[0], level > 0),
+                      image.rows / 64.0);
+
+    // --- Two strips per thread evens out strips that compress slower ---
+    if (strips <= 0)
+    {
+        strips = 2 * std::max(1, cv::getNumThreads());
+    }
+    int stripRows = (image.rows + strips - 1) / strips;
+    if (stripRows < minimumStripRows)
+    {
+        stripRows = minimumStripRows;
+    }
+    strips = (image.rows + stripRows - 1) / stripRows;
+
+    std::vector<size_t> offsets(strips + 1);
+    for (int strip=0; strip < strips; strip++)
+    {
+        offsets[strip] = lineBytes * (strip * stripRows);
+    }
+    offsets[strips] = filtered.size();
+
+    std::vector< std::vector<uchar> > outputs(strips);
+    std::vector<uLong> checksums(strips);
+    std::vector<int> status(strips, 0);
+    cv::parallel_for_(cv::Range(0, strips),
+                      DeflateStrips(&filtered[0], offsets, level, outputs, checksums, status));
+
+    for (int strip=0; strip < strips; strip++)
+    {
+        if (!status[strip])
+        {
+            return false;
+        }
+    }
+
+    // --- zlib header in front of the first strip, combined Adler-32 after the last ---
+    uLong adler = checksums[0];
+    for (int strip=1; strip < strips; strip++)
+    {
+        adler = adler32_combine(adler, checksums[strip],
+                                static_cast<z_off_t>(offsets[strip + 1] - offsets[strip]));
+    }
+
+    const int headerLevel = level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3));
+    uchar header[2] = { 0x78, static_cast<uchar>(headerLevel << 6) };
+    header[1] = static_cast<uchar>(header[1] + 31 - ((header[0] << 8 | header[1]) % 31));
+    outputs[0][0] = header[0];
+    outputs[0][1] = header[1];
+    appendBigEndian(outputs[strips - 1], static_cast<quint32>(adler));
+
+    // --- Signature, IHDR, one IDAT per strip, IEND ---
+    size_t total = sizeof(pngSignature) + 25 + 12;
+    for (int strip=0; strip < strips; strip++)
+    {
+        total += outputs[strip].size() + 12;
+    }
+
+    buffer.clear();
+    buffer.reserve(total);
+    buffer.insert(buffer.end(), pngSignature, pngSignature + sizeof(pngSignature));
+
+    std::vector<uchar> imageHeader;
+    appendBigEndian(imageHeader, static_cast<quint32>(image.cols));
+    appendBigEndian(imageHeader, static_cast<quint32>(image.rows));
+    imageHeader.push_back(8);
+    imageHeader.push_back(channels == 1 ? 0 : (channels == 3 ? 2 : 6));
+    imageHeader.push_back(0);
+    imageHeader.push_back(0);
+    imageHeader.push_back(0);
+    appendChunk(buffer, "IHDR", &imageHeader[0], imageHeader.size());
+
+    for (int strip=0; strip < strips; strip++)
+    {
+        appendChunk(buffer, "IDAT", &outputs[strip][0], outputs[strip].size());
+        std::vector<uchar>().swap(outputs[strip]);
+    }
+    appendChunk(buffer, "IEND", 0, 0);
+
+    return true;
+}
+
+bool PngWriter::write(QString filePath,
+                      const cv::Mat& image,
+                      int compression,
+                      int strips,
+                      QString *errorString)
+{
+    std::vector<uchar> buffer;
+
+    if (!encode(image, buffer, compression, strips))
+    {
+        if (errorString) *errorString = QString("Only 8-bit gray, BGR and BGRA images are supported");
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size())
+                   != static_cast<qint64>(buffer.size()))
+    {
+        if (errorString) *errorString = QString("Cannot write ") + filePath;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <vector>
+
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+// --- Multi-threaded PNG encoder for 8-bit gray, BGR and BGRA images. ---
+// Rows are filtered in parallel and the filtered data is cut into horizontal
+// strips that are deflated on separate threads. Every strip but the last ends
+// in a sync flush, so the raw deflate streams join byte-aligned into a single
+// zlib stream and the file is an ordinary PNG. Each strip is primed with the
+// last 32 KiB of the strip before it, which keeps most of the ratio that
+// independent streams would otherwise lose.
+class PngWriter
+{
+public:
+    static const int minimumStripRows = 16;
+
+    // --- Accessors ---
+    static bool isSupported(const cv::Mat& image);
+
+    // --- Encoding ---
+    static bool encode(const cv::Mat& image,
+                       std::vector<uchar>& buffer,
+                       int compression = 3,
+                       int strips = 0);
+    static bool write(QString filePath,
+                      const cv::Mat& image,
+                      int compression = 3,
+                      int strips = 0,
+                      QString *errorString = 0);
+};
+
+#endif // PNGWRITER_H
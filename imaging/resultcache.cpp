@@ -0,0 +1,139 @@
+#include "resultcache.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+// ----- Constructor / Destructor ---------------------------------------------
+ResultCache::ResultCache(size_t budgetBytes)
+{
+    limit = budgetBytes;
+    clock = 0;
+
+    counters.hits = 0;
+    counters.misses = 0;
+    counters.evictions = 0;
+    counters.bytes = 0;
+    counters.entries = 0;
+}
+
+ResultCache::~ResultCache()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+size_t ResultCache::budget() const
+{
+    QMutexLocker locker(&mutex);
+    return limit;
+}
+
+ResultCache::Statistics ResultCache::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- The entry shares the cached pixels; copy them before writing ---
+bool ResultCache::lookup(quint64 sourceHash, const QString& parameters, Entry& entry)
+{
+    QMutexLocker locker(&mutex);
+
+    QHash<QString, Slot>::iterator slot = slots.find(key(sourceHash, parameters));
+    if (slot == slots.end())
+    {
+        counters.misses++;
+        return false;
+    }
+
+    slot->lastUse = ++clock;
+    entry = slot->entry;
+    counters.hits++;
+    return true;
+}
+
+// --- Stores a copy, so the caller may keep writing into its own image ---
+void ResultCache::insert(quint64 sourceHash, const QString& parameters, const Entry& entry)
+{
+    Slot slot;
+    slot.entry.image = entry.image.clone();
+    slot.entry.channelLUT = entry.channelLUT.clone();
+    slot.entry.channelMapped = entry.channelMapped;
+    slot.bytes = entry.image.total() * entry.image.elemSize();
+
+    QMutexLocker locker(&mutex);
+    if (slot.bytes > limit)
+    {
+        return;
+    }
+
+    QString name = key(sourceHash, parameters);
+    if (slots.contains(name))
+    {
+        counters.bytes -= slots.value(name).bytes;
+    }
+
+    slot.lastUse = ++clock;
+    slots.insert(name, slot);
+    counters.bytes += slot.bytes;
+
+    evict();
+    counters.entries = slots.size();
+}
+
+void ResultCache::setBudget(size_t budgetBytes)
+{
+    QMutexLocker locker(&mutex);
+    limit = budgetBytes;
+
+    evict();
+    counters.entries = slots.size();
+}
+
+void ResultCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    slots.clear();
+    counters.bytes = 0;
+    counters.entries = 0;
+}
+
+// --- Drop least recently used entries until the budget holds ---
+// A scan per eviction is fine: a budget holds tens of full frames, not more.
+void ResultCache::evict()
+{
+    while (counters.bytes > static_cast<qint64>(limit) && !slots.isEmpty())
+    {
+        QHash<QString, Slot>::iterator oldest = slots.begin();
+        for (QHash<QString, Slot>::iterator slot = slots.begin(); slot != slots.end(); ++slot)
+        {
+            if (slot->lastUse < oldest->lastUse)
+            {
+                oldest = slot;
+            }
+        }
+
+        counters.bytes -= oldest->bytes;
+        counters.evictions++;
+        slots.erase(oldest);
+    }
+}
+
+// ----- Keys -----------------------------------------------------------------
+// --- Sorted names, fixed precision and no negative zero: equal sets, equal text ---
+QString ResultCache::canonicalParameters(const QMap<QString, double>& parameters)
+{
+    QStringList fields;
+    for (QMap<QString, double>::const_iterator item = parameters.begin(); item != parameters.end(); ++item)
+    {
+        double value = item.value() == 0.0 ? 0.0 : item.value();
+        fields << item.key() + "=" + QString::number(value, 'g', 12);
+    }
+    return fields.join(";");
+}
+
+QString ResultCache::key(quint64 sourceHash, const QString& parameters)
+{
+    return QString::number(sourceHash, 16) + "|" + parameters;
+}
@@ -0,0 +1,72 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+// --- Memo of adjusted images keyed by source content and parameters. ---
+// Sliders moved back to a setting already seen get that output back without
+// running the adjustment again. Keys pair a hash of the source pixels with a
+// canonical text form of the parameters, so equal settings match however
+// they were reached. Entries are private copies and are evicted least
+// recently used first once their total size passes the memory budget.
+class ResultCache
+{
+public:
+    struct Entry
+    {
+        cv::Mat image;
+        cv::Mat channelLUT;     // as in MyImage, to derive the histogram
+        bool channelMapped;
+    };
+
+    struct Statistics
+    {
+        qint64 hits;
+        qint64 misses;
+        qint64 evictions;
+        qint64 bytes;           // pixels currently held
+        int entries;
+    };
+
+    // --- Constructor / Destructor ---
+    explicit ResultCache(size_t budgetBytes = size_t(256) * 1024 * 1024);
+    ~ResultCache();
+
+    // --- Accessors ---
+    size_t budget() const;
+    Statistics statistics() const;
+
+    // --- Mutators ---
+    bool lookup(quint64 sourceHash, const QString& parameters, Entry& entry);
+    void insert(quint64 sourceHash, const QString& parameters, const Entry& entry);
+    void setBudget(size_t budgetBytes);
+    void clear();
+
+    // --- Keys ---
+    static QString canonicalParameters(const QMap<QString, double>& parameters);
+
+private:
+    struct Slot
+    {
+        Entry entry;
+        size_t bytes;
+        qint64 lastUse;
+    };
+
+    size_t limit;
+    qint64 clock;
+    QHash<QString, Slot> slots;
+
+    mutable QMutex mutex;
+    Statistics counters;
+
+    static QString key(quint64 sourceHash, const QString& parameters);
+    void evict();
+};
+
+#endif // RESULTCACHE_H
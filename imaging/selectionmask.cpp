@@ -0,0 +1,158 @@
+#include "selectionmask.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "imagehash.h"
+
+// ----- Constructor / Destructor ---------------------------------------------
+SelectionMask::SelectionMask()
+{
+    featherRadius = 0;
+    tilesAcross = 0;
+    hash = 0;
+}
+
+SelectionMask::~SelectionMask()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool SelectionMask::isEmpty() const
+{
+    return selectedBounds.area() == 0;
+}
+
+cv::Size SelectionMask::size() const
+{
+    return hardMask.size();
+}
+
+int SelectionMask::feather() const
+{
+    return featherRadius;
+}
+
+const cv::Mat& SelectionMask::weights() const
+{
+    return softMask;
+}
+
+cv::Rect SelectionMask::bounds() const
+{
+    return selectedBounds;
+}
+
+SelectionMask::Coverage SelectionMask::coverage(int tileX, int tileY) const
+{
+    if (tiles.empty())
+    {
+        return EmptyTile;
+    }
+    return static_cast<Coverage>(tiles[tileY * tilesAcross + tileX]);
+}
+
+quint64 SelectionMask::contentHash() const
+{
+    return hash;
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- A new, empty selection over an image of imageSize ---
+void SelectionMask::reset(cv::Size imageSize)
+{
+    hardMask = cv::Mat::zeros(imageSize, CV_8UC1);
+    softMask.release();
+    selectedBounds = cv::Rect();
+    tiles.clear();
+    hash = 0;
+}
+
+void SelectionMask::clear()
+{
+    reset(hardMask.size());
+}
+
+void SelectionMask::addRect(cv::Rect rect)
+{
+    rect &= cv::Rect(0, 0, hardMask.cols, hardMask.rows);
+    if (rect.area() > 0)
+    {
+        hardMask(rect).setTo(cv::Scalar(255));
+    }
+}
+
+// --- A round-capped line, so dragging the brush leaves no gaps ---
+void SelectionMask::addStroke(cv::Point from, cv::Point to, int radius)
+{
+    if (!hardMask.empty())
+    {
+        cv::line(hardMask, from, to, cv::Scalar(255), std::max(1, 2 * radius));
+    }
+}
+
+void SelectionMask::setFeather(int radius)
+{
+    featherRadius = std::max(0, radius);
+}
+
+// --- Feather around what was drawn and classify the tiles; call after drawing ---
+void SelectionMask::finish()
+{
+    selectedBounds = cv::Rect();
+    tiles.clear();
+    hash = 0;
+
+    if (hardMask.empty() || cv::countNonZero(hardMask) == 0)
+    {
+        softMask.release();
+        return;
+    }
+
+    cv::Rect image(0, 0, hardMask.cols, hardMask.rows);
+    int margin = 2 * featherRadius;
+    cv::Rect drawn = cv::boundingRect(hardMask);
+    cv::Rect area = cv::Rect(drawn.x - margin, drawn.y - margin,
+                             drawn.width + 2 * margin, drawn.height + 2 * margin) & image;
+
+    softMask = cv::Mat::zeros(hardMask.size(), CV_8UC1);
+    if (featherRadius > 0)
+    {
+        cv::GaussianBlur(hardMask(area), softMask(area),
+                         cv::Size(2 * featherRadius + 1, 2 * featherRadius + 1),
+                         featherRadius / 2.0);
+    }
+    else
+    {
+        hardMask(area).copyTo(softMask(area));
+    }
+
+    cv::Rect soft = cv::boundingRect(softMask(area));
+    selectedBounds = cv::Rect(soft.x + area.x, soft.y + area.y, soft.width, soft.height);
+
+    // --- Tiles outside the bounds are empty without looking at them ---
+    tilesAcross = (softMask.cols + tileSize - 1) / tileSize;
+    int tilesDown = (softMask.rows + tileSize - 1) / tileSize;
+    tiles.assign(tilesAcross * tilesDown, EmptyTile);
+
+    for (int tileY=0; tileY < tilesDown; tileY++)
+    {
+        for (int tileX=0; tileX < tilesAcross; tileX++)
+        {
+            cv::Rect rect = cv::Rect(tileX * tileSize, tileY * tileSize, tileSize, tileSize) & image;
+            if ((rect & selectedBounds).area() == 0)
+            {
+                continue;
+            }
+
+            double lowest, highest;
+            cv::minMaxLoc(softMask(rect), &lowest, &highest);
+            if (lowest >= 255.0) tiles[tileY * tilesAcross + tileX] = FullTile;
+            else if (highest > 0.0) tiles[tileY * tilesAcross + tileX] = PartialTile;
+        }
+    }
+
+    hash = ImageHash::hash(softMask);
+}
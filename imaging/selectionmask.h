@@ -0,0 +1,58 @@
+#ifndef SELECTIONMASK_H
+#define SELECTIONMASK_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include <opencv2/core/core.hpp>
+
+// --- Region an adjustment is limited to: rectangles and brush strokes. ---
+// Shapes are drawn into a hard 0/255 mask; finish() feathers it (a blur of
+// the selected area plus its border only) and sorts tiles into empty, full
+// and partial, so a masked kernel copies or skips most tiles outright and
+// blends per pixel only where the soft edge lies.
+class SelectionMask
+{
+public:
+    enum Coverage
+    {
+        EmptyTile,      // nothing selected, output is the input
+        PartialTile,    // blend by weight
+        FullTile        // fully selected, plain kernel
+    };
+
+    static const int tileSize = 64;
+
+    // --- Constructor / Destructor ---
+    SelectionMask();
+    ~SelectionMask();
+
+    // --- Accessors ---
+    bool isEmpty() const;
+    cv::Size size() const;
+    int feather() const;
+    const cv::Mat& weights() const;     // CV_8UC1, 255 fully selected
+    cv::Rect bounds() const;            // of the feathered selection
+    Coverage coverage(int tileX, int tileY) const;
+    quint64 contentHash() const;        // 0 when empty
+
+    // --- Mutators ---
+    void reset(cv::Size imageSize);
+    void clear();
+    void addRect(cv::Rect rect);
+    void addStroke(cv::Point from, cv::Point to, int radius);
+    void setFeather(int radius);
+    void finish();
+
+private:
+    cv::Mat hardMask;
+    cv::Mat softMask;
+    int featherRadius;
+    cv::Rect selectedBounds;
+    std::vector<uchar> tiles;
+    int tilesAcross;
+    quint64 hash;
+};
+
+#endif // SELECTIONMASK_H
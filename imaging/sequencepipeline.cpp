@@ -0,0 +1,446 @@
+#include "sequencepipeline.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMap>
+#include <QMutexLocker>
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#include "imageexporter.h"
+#include "myimage.h"
+#include "tiledimagefile.h"
+
+namespace {
+
+// --- Runs one stage loop on its own thread ---
+class StageThread : public QThread
+{
+public:
+    explicit StageThread(std::function<void()> stageLoop) : body(stageLoop) {}
+
+protected:
+    void run()
+    {
+        body();
+    }
+
+private:
+    std::function<void()> body;
+};
+
+// --- Decode into frame, reading the file into a reused byte buffer ---
+bool decodeFrame(QString filePath, std::vector<uchar>& bytes, cv::Mat& frame)
+{
+    if (TiledImageFile::isTiledFile(filePath))
+    {
+        return TiledImageFile::load(filePath, frame);
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    bytes.resize(static_cast<size_t>(file.size()));
+    if (bytes.empty() || file.read(reinterpret_cast<char*>(&bytes[0]), file.size()) != file.size())
+    {
+        return false;
+    }
+
+    // --- imdecode leaves a recycled frame untouched when it cannot decode ---
+    frame.release();
+    cv::imdecode(bytes, cv::IMREAD_COLOR, &frame);
+    return !frame.empty();
+}
+
+}
+
+// ----- Settings -------------------------------------------------------------
+SequencePipeline::Settings::Settings()
+{
+    int cores = std::max(1, QThread::idealThreadCount());
+
+    readThreads = 2;
+    processThreads = std::max(1, cores / 4);
+    encodeThreads = std::max(1, cores - processThreads - readThreads);
+    readAhead = 8;
+    pngCompression = 1;
+    fourcc = "MJPG";
+    temporalTileSize = TemporalTileCache::defaultTileSize;
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+// --- The ring holds one buffer per thread plus both queues full ---
+SequencePipeline::SequencePipeline(const CompiledPreset& preset, const Settings& settings) :
+    compiled(preset),
+    config(settings),
+    source(0),
+    sourceRate(24.0),
+    readers(1),
+    processors(1),
+    encoders(1),
+    temporalCache(settings.temporalTileSize),
+    freeBuffers(std::max(1, settings.readThreads) + std::max(1, settings.processThreads)
+                + std::max(1, settings.encodeThreads) + 2 * std::max(1, settings.readAhead)),
+    decodedQueue(settings.readAhead),
+    processedQueue(settings.readAhead)
+{
+    counters.frames = 0;
+    counters.failed = 0;
+    counters.readNanoseconds = 0;
+    counters.processNanoseconds = 0;
+    counters.encodeNanoseconds = 0;
+    counters.wallNanoseconds = 0;
+}
+
+SequencePipeline::~SequencePipeline()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+SequencePipeline::Statistics SequencePipeline::statistics() const
+{
+    QMutexLocker locker(&statisticsMutex);
+    return counters;
+}
+
+TemporalTileCache::Statistics SequencePipeline::temporalStatistics() const
+{
+    return temporalCache.statistics();
+}
+
+// --- Per-frame cost of each stage divided by its threads: the largest wins ---
+QString SequencePipeline::report() const
+{
+    Statistics stats = statistics();
+    int frames = std::max(1, stats.frames + stats.failed);
+
+    double read = 1e-6 * stats.readNanoseconds / frames;
+    double process = 1e-6 * stats.processNanoseconds / frames;
+    double encode = 1e-6 * stats.encodeNanoseconds / frames;
+    double wall = 1e-9 * stats.wallNanoseconds;
+    double rate = wall > 0.0 ? (stats.frames + stats.failed) / wall : 0.0;
+
+    double perRead = read / readers;
+    double perProcess = process / processors;
+    double perEncode = encode / encoders;
+
+    QString slowest = "encode";
+    if (perRead >= perProcess && perRead >= perEncode) slowest = "read";
+    else if (perProcess >= perEncode) slowest = "process";
+
+    QString text = QString("%1 frames (%2 failed) in %3 s, %4 frames/s, %5x real time at %6 fps\n"
+                   "  read    %7 ms/frame x %8 threads\n"
+                   "  process %9 ms/frame x %10 threads\n"
+                   "  encode  %11 ms/frame x %12 threads\n"
+                   "  bottleneck: %13")
+            .arg(stats.frames + stats.failed)
+            .arg(stats.failed)
+            .arg(wall, 0, 'f', 2)
+            .arg(rate, 0, 'f', 1)
+            .arg(rate / sourceRate, 0, 'f', 2)
+            .arg(sourceRate, 0, 'f', 2)
+            .arg(read, 0, 'f', 1).arg(readers)
+            .arg(process, 0, 'f', 1).arg(processors)
+            .arg(encode, 0, 'f', 1).arg(encoders)
+            .arg(slowest);
+
+    if (config.temporalTileSize > 0)
+    {
+        text += "\n  " + temporalCache.report();
+    }
+    return text;
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- output is a video file, a numbered pattern or a folder for frame_%06d.png ---
+bool SequencePipeline::run(FrameSequence& input, QString output, QString *errorString)
+{
+    if (!input.isOpen() || source != 0)
+    {
+        if (errorString) *errorString = QString("Sequence is not open");
+        return false;
+    }
+
+    bool videoOutput = FrameSequence::isVideoFile(output);
+    if (videoOutput || FrameSequence::isPattern(output))
+    {
+        outputPath = output;
+        QDir().mkpath(QFileInfo(output).absolutePath());
+    }
+    else
+    {
+        QDir directory(output);
+        directory.mkpath(".");
+        outputPath = directory.absoluteFilePath("frame_%06d.png");
+    }
+
+    source = &input;
+    sourceRate = input.framesPerSecond();
+    readers = input.isVideo() ? 1 : std::max(1, config.readThreads);
+    encoders = videoOutput ? 1 : std::max(1, config.encodeThreads);
+    processors = config.temporalTileSize > 0 ? 1 : std::max(1, config.processThreads);
+
+    nextFrame.store(0);
+    readersLeft.store(readers);
+    processorsLeft.store(processors);
+
+    // --- Empty headers; each gets its buffer on first decode and keeps it ---
+    for (int index=0; index < readers + processors + encoders + 2 * std::max(1, config.readAhead); index++)
+    {
+        freeBuffers.tryPush(cv::Mat());
+    }
+
+    QElapsedTimer wallClock;
+    wallClock.start();
+
+    QList<QThread*> workers;
+    for (int index=0; index < readers; index++)
+    {
+        workers.append(new StageThread([this]() { readLoop(); }));
+    }
+    for (int index=0; index < processors; index++)
+    {
+        if (config.temporalTileSize > 0) workers.append(new StageThread([this]() { temporalLoop(); }));
+        else workers.append(new StageThread([this]() { processLoop(); }));
+    }
+    for (int index=0; index < encoders; index++)
+    {
+        if (videoOutput) workers.append(new StageThread([this]() { videoLoop(); }));
+        else workers.append(new StageThread([this]() { encodeLoop(); }));
+    }
+
+    for (int index=0; index < workers.size(); index++)
+    {
+        workers.at(index)->start();
+    }
+    for (int index=0; index < workers.size(); index++)
+    {
+        workers.at(index)->wait();
+        delete workers.at(index);
+    }
+
+    {
+        QMutexLocker locker(&statisticsMutex);
+        counters.wallNanoseconds = wallClock.nsecsElapsed();
+    }
+
+    if (!writeError.isEmpty())
+    {
+        if (errorString) *errorString = writeError;
+        return false;
+    }
+    return true;
+}
+
+// ----- Stage Loops ----------------------------------------------------------
+// --- A buffer is taken before a frame number, so every claimed frame can finish ---
+void SequencePipeline::readLoop()
+{
+    std::vector<uchar> bytes;
+    int count = source->frameCount();
+
+    SequenceFrame frame;
+    while (freeBuffers.pop(frame.image))
+    {
+        frame.index = nextFrame.fetchAndAddOrdered(1);
+        if (!source->isVideo() && frame.index >= count)
+        {
+            break;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        if (source->isVideo())
+        {
+            if (!source->readFrame(frame.image))
+            {
+                break;
+            }
+            frame.succeeded = frame.image.type() == CV_8UC3;
+        }
+        else
+        {
+            frame.succeeded = decodeFrame(source->framePath(frame.index), bytes, frame.image)
+                    && frame.image.type() == CV_8UC3;
+        }
+
+        addTime(&Statistics::readNanoseconds, timer.nsecsElapsed());
+        if (!decodedQueue.push(frame))
+        {
+            break;
+        }
+    }
+
+    if (readersLeft.fetchAndAddOrdered(-1) == 1)
+    {
+        decodedQueue.close();
+    }
+}
+
+void SequencePipeline::processLoop()
+{
+    SequenceFrame frame;
+    while (decodedQueue.pop(frame))
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (frame.succeeded)
+        {
+            MyImage processor("Sequence Process");
+            processor.image = frame.image;
+            processor.applyPreset(processor.image, compiled);
+            frame.image = processor.image;
+        }
+
+        addTime(&Statistics::processNanoseconds, timer.nsecsElapsed());
+        if (!processedQueue.push(frame))
+        {
+            break;
+        }
+    }
+
+    if (processorsLeft.fetchAndAddOrdered(-1) == 1)
+    {
+        processedQueue.close();
+    }
+}
+
+// --- Frames are put back in order so each is compared with its predecessor ---
+void SequencePipeline::temporalLoop()
+{
+    QMap<int, SequenceFrame> waiting;
+    int expected = 0;
+
+    SequenceFrame frame;
+    while (decodedQueue.pop(frame))
+    {
+        waiting.insert(frame.index, frame);
+
+        while (waiting.contains(expected))
+        {
+            SequenceFrame next = waiting.take(expected++);
+
+            QElapsedTimer timer;
+            timer.start();
+
+            if (next.succeeded)
+            {
+                temporalCache.apply(next.image, compiled);
+            }
+
+            addTime(&Statistics::processNanoseconds, timer.nsecsElapsed());
+            if (!processedQueue.push(next))
+            {
+                break;
+            }
+        }
+    }
+
+    if (processorsLeft.fetchAndAddOrdered(-1) == 1)
+    {
+        processedQueue.close();
+    }
+}
+
+void SequencePipeline::encodeLoop()
+{
+    ExportOptions options;
+    options.pngCompression = config.pngCompression;
+
+    SequenceFrame frame;
+    while (processedQueue.pop(frame))
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (frame.succeeded)
+        {
+            QString filePath = FrameSequence::expandPattern(outputPath, frame.index);
+            options.format = ExportOptions::formatForPath(filePath);
+            frame.succeeded = ImageExporter::write(filePath, frame.image, options);
+        }
+
+        addTime(&Statistics::encodeNanoseconds, timer.nsecsElapsed());
+        finishFrame(frame);
+    }
+}
+
+// --- Frames arrive in any order and are held back until their turn ---
+void SequencePipeline::videoLoop()
+{
+    cv::VideoWriter writer;
+    cv::Size frameSize;
+    QMap<int, SequenceFrame> waiting;
+    int expected = 0;
+
+    QByteArray code = config.fourcc.toLatin1().leftJustified(4, ' ');
+    int fourcc = cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+
+    SequenceFrame frame;
+    while (processedQueue.pop(frame))
+    {
+        waiting.insert(frame.index, frame);
+
+        while (waiting.contains(expected))
+        {
+            SequenceFrame next = waiting.take(expected++);
+
+            QElapsedTimer timer;
+            timer.start();
+
+            if (next.succeeded && !writer.isOpened() && writeError.isEmpty())
+            {
+                frameSize = next.image.size();
+                if (!writer.open(outputPath.toStdString(), fourcc, sourceRate, frameSize, true))
+                {
+                    writeError = QString("Cannot open video writer for ") + outputPath;
+                }
+            }
+
+            // --- Every frame must match the first one's size ---
+            next.succeeded = next.succeeded && writer.isOpened() && next.image.size() == frameSize;
+            if (next.succeeded)
+            {
+                writer.write(next.image);
+            }
+
+            addTime(&Statistics::encodeNanoseconds, timer.nsecsElapsed());
+            finishFrame(next);
+        }
+    }
+
+    writer.release();
+}
+
+// --- Count the frame and hand its buffer back to the readers ---
+void SequencePipeline::finishFrame(SequenceFrame& frame)
+{
+    {
+        QMutexLocker locker(&statisticsMutex);
+        if (frame.succeeded) counters.frames++;
+        else counters.failed++;
+    }
+
+    freeBuffers.tryPush(frame.image);
+    frame.image = cv::Mat();
+}
+
+void SequencePipeline::addTime(qint64 Statistics::*field, qint64 nanoseconds)
+{
+    QMutexLocker locker(&statisticsMutex);
+    counters.*field += nanoseconds;
+}
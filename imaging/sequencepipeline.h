@@ -0,0 +1,105 @@
+#ifndef SEQUENCEPIPELINE_H
+#define SEQUENCEPIPELINE_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+
+#include <opencv2/core/core.hpp>
+
+#include "adjustmentpreset.h"
+#include "boundedqueue.h"
+#include "framesequence.h"
+#include "temporaltilecache.h"
+
+// --- One frame moving through the pipeline ---
+struct SequenceFrame
+{
+    int index;
+    cv::Mat image;
+    bool succeeded;
+};
+
+// --- Streaming read-ahead / adjust / write-behind pipeline for sequences. ---
+// Frames live in a fixed ring of buffers: a reader decodes into a free one,
+// it is adjusted in place, and the writer hands it back once encoded. After
+// the first few frames nothing is allocated, and a long sequence runs in the
+// same memory as a short one. Numbered image output is encoded by several
+// threads in any order; video output is written by one thread that puts the
+// frames back in order. With temporal tiles on, one thread adjusts frames in
+// order (tiles in parallel) so unchanged tiles reuse the previous frame's
+// output. A pipeline runs one sequence.
+class SequencePipeline
+{
+public:
+    struct Settings
+    {
+        int readThreads;        // image sequences only, a video has one reader
+        int processThreads;
+        int encodeThreads;      // image output only, a video has one writer
+        int readAhead;          // frames buffered between two stages
+        int pngCompression;     // 0..9, low by default to keep up with playback
+        QString fourcc;         // video output codec
+        int temporalTileSize;   // 0 adjusts every frame in full
+
+        Settings();
+    };
+
+    struct Statistics
+    {
+        int frames;
+        int failed;
+        qint64 readNanoseconds;     // summed over the stage's threads
+        qint64 processNanoseconds;
+        qint64 encodeNanoseconds;
+        qint64 wallNanoseconds;
+    };
+
+    // --- Constructor / Destructor ---
+    SequencePipeline(const CompiledPreset& preset, const Settings& settings = Settings());
+    ~SequencePipeline();
+
+    // --- Accessors ---
+    Statistics statistics() const;
+    TemporalTileCache::Statistics temporalStatistics() const;
+    QString report() const;
+
+    // --- Mutators ---
+    bool run(FrameSequence& input, QString output, QString *errorString = 0);
+
+private:
+    CompiledPreset compiled;
+    Settings config;
+
+    FrameSequence *source;
+    QString outputPath;
+    QString writeError;
+    double sourceRate;
+    int readers;
+    int processors;
+    int encoders;
+
+    TemporalTileCache temporalCache;
+
+    BoundedQueue<cv::Mat> freeBuffers;
+    BoundedQueue<SequenceFrame> decodedQueue;
+    BoundedQueue<SequenceFrame> processedQueue;
+
+    QAtomicInt nextFrame;
+    QAtomicInt readersLeft;
+    QAtomicInt processorsLeft;
+
+    mutable QMutex statisticsMutex;
+    Statistics counters;
+
+    void readLoop();
+    void processLoop();
+    void temporalLoop();
+    void encodeLoop();
+    void videoLoop();
+    void finishFrame(SequenceFrame& frame);
+    void addTime(qint64 Statistics::*field, qint64 nanoseconds);
+};
+
+#endif // SEQUENCEPIPELINE_H
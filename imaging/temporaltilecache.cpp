@@ -0,0 +1,155 @@
+#include "temporaltilecache.h"
+
+#include <algorithm>
+
+#include <QAtomicInt>
+#include <QMutexLocker>
+
+#include <opencv2/core/utility.hpp>
+
+#include "imagehash.h"
+
+// ----- Tile Pass ------------------------------------------------------------
+// --- One tile per index: copy the old output or adjust in place ---
+class TemporalTileCache::ParallelTiles : public cv::ParallelLoopBody
+{
+public:
+    ParallelTiles(TemporalTileCache& owner,
+                  cv::Mat& frameImage,
+                  const CompiledPreset& compiled,
+                  const std::vector<quint64>& tileHashes,
+                  QAtomicInt& reusedTiles)
+        : cache(owner), frame(frameImage), preset(compiled), hashes(tileHashes), reused(reusedTiles)
+    {
+        across = (frame.cols + cache.size - 1) / cache.size;
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int index=range.start; index < range.end; index++)
+        {
+            int x = (index % across) * cache.size;
+            int y = (index / across) * cache.size;
+            cv::Rect rect(x, y, std::min(cache.size, frame.cols - x), std::min(cache.size, frame.rows - y));
+
+            cv::Mat tile = frame(rect);
+            cv::Mat previous = cache.previousOutput(rect);
+            quint64 hash = hashes[index];
+
+            if (cache.previousValid[index] && cache.previousHashes[index] == hash)
+            {
+                previous.copyTo(tile);
+                reused.fetchAndAddRelaxed(1);
+                continue;
+            }
+
+            switch (preset.kernel)
+            {
+            case CompiledPreset::ChannelKernel:
+                cv::LUT(tile, preset.channelLUT, tile);
+                break;
+
+            case CompiledPreset::Table3DKernel:
+                preset.lut.apply(tile, tile);
+                break;
+
+            default:
+                break;
+            }
+
+            tile.copyTo(previous);
+            cache.previousHashes[index] = hash;
+            cache.previousValid[index] = 1;
+        }
+    }
+
+private:
+    TemporalTileCache& cache;
+    cv::Mat& frame;
+    const CompiledPreset& preset;
+    const std::vector<quint64>& hashes;
+    QAtomicInt& reused;
+    int across;
+};
+
+// ----- Statistics -----------------------------------------------------------
+double TemporalTileCache::Statistics::hitRate() const
+{
+    return tiles > 0 ? static_cast<double>(reused) / tiles : 0.0;
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+TemporalTileCache::TemporalTileCache(int tileSize)
+{
+    size = std::max(8, tileSize);
+
+    counters.frames = 0;
+    counters.tiles = 0;
+    counters.reused = 0;
+}
+
+TemporalTileCache::~TemporalTileCache()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+int TemporalTileCache::tileSize() const
+{
+    return size;
+}
+
+TemporalTileCache::Statistics TemporalTileCache::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+QString TemporalTileCache::report() const
+{
+    Statistics stats = statistics();
+    return QString("temporal cache: %1% of %2 tiles reused (%3 px tiles, %4 frames)")
+            .arg(100.0 * stats.hitRate(), 0, 'f', 1)
+            .arg(stats.tiles)
+            .arg(size)
+            .arg(stats.frames);
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- Adjusts frame in place; a change of size or type starts over ---
+void TemporalTileCache::apply(cv::Mat& frame, const CompiledPreset& preset)
+{
+    QMutexLocker locker(&mutex);
+
+    if (frame.empty())
+    {
+        return;
+    }
+
+    int across = (frame.cols + size - 1) / size;
+    int down = (frame.rows + size - 1) / size;
+    if (previousOutput.size() != frame.size() || previousOutput.type() != frame.type())
+    {
+        previousOutput.create(frame.size(), frame.type());
+        previousHashes.assign(across * down, 0);
+        previousValid.assign(across * down, 0);
+    }
+
+    std::vector<quint64> hashes = ImageHash::tileHashes(frame, size);
+
+    QAtomicInt reused(0);
+    cv::parallel_for_(cv::Range(0, across * down), ParallelTiles(*this, frame, preset, hashes, reused));
+
+    counters.frames++;
+    counters.tiles += across * down;
+    counters.reused += reused.load();
+}
+
+// --- Call when the preset changes, old outputs no longer apply ---
+void TemporalTileCache::reset()
+{
+    QMutexLocker locker(&mutex);
+    previousOutput.release();
+    previousHashes.clear();
+    previousValid.clear();
+}
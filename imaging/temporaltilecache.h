@@ -0,0 +1,59 @@
+#ifndef TEMPORALTILECACHE_H
+#define TEMPORALTILECACHE_H
+
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+#include "adjustmentpreset.h"
+
+// --- Reuses output tiles that did not change since the previous frame. ---
+// Each frame is cut into square tiles, all hashed with ImageHash in one
+// parallel pass. When a tile hashes the same as the one at the same place in
+// the previous frame, its previous output is copied instead of being adjusted
+// again; static backgrounds and letterbox bars cost a hash and a copy. Only
+// valid for per-pixel kernels, which is all a CompiledPreset can hold.
+// Frames must be fed in order to get the hit rate the footage allows.
+class TemporalTileCache
+{
+public:
+    static const int defaultTileSize = 64;
+
+    struct Statistics
+    {
+        qint64 frames;
+        qint64 tiles;           // tiles looked up
+        qint64 reused;          // tiles copied from the previous frame
+
+        double hitRate() const;
+    };
+
+    // --- Constructor / Destructor ---
+    explicit TemporalTileCache(int tileSize = defaultTileSize);
+    ~TemporalTileCache();
+
+    // --- Accessors ---
+    int tileSize() const;
+    Statistics statistics() const;
+    QString report() const;
+
+    // --- Mutators ---
+    void apply(cv::Mat& frame, const CompiledPreset& preset);
+    void reset();
+
+private:
+    class ParallelTiles;
+
+    int size;
+    cv::Mat previousOutput;
+    std::vector<quint64> previousHashes;
+    std::vector<uchar> previousValid;
+
+    mutable QMutex mutex;
+    Statistics counters;
+};
+
+#endif // TEMPORALTILECACHE_H
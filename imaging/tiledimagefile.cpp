@@ -0,0 +1,659 @@
+#include "tiledimagefile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QFileInfo>
+#include <QtEndian>
+
+namespace {
+
+const char fileMagic[4] = { 'I', 'C', 'T', 'I' };
+const quint16 fileVersion = 1;
+const int headerBytes = 48;
+const int entryBytes = 16;
+const quint64 lz4MaximumRatio = 255;    // one length byte extends a match by 255
+
+// ----- LZ4 Block Codec ------------------------------------------------------
+// --- Greedy LZ4 block format: 4-byte minimum match, 64 KiB window ---
+const int hashBits = 12;
+const int minimumMatch = 4;
+const int lastLiterals = 5;
+const int matchFindLimit = 12;
+
+inline quint32 read32(const uchar *pointer)
+{
+    quint32 value;
+    std::memcpy(&value, pointer, sizeof(value));
+    return value;
+}
+
+inline void writeLength(uchar *&output, size_t length)
+{
+    while (length >= 255)
+    {
+        *output++ = 255;
+        length -= 255;
+    }
+    *output++ = static_cast<uchar>(length);
+}
+
+inline size_t lz4Bound(size_t length)
+{
+    return length + length / 255 + 16;
+}
+
+size_t lz4Compress(const uchar *source, size_t length, uchar *destination)
+{
+    const uchar *input = source;
+    const uchar *anchor = source;
+    const uchar *end = source + length;
+    uchar *output = destination;
+
+    std::vector<quint32> table(1 << hashBits, 0);
+
+    if (length > static_cast<size_t>(matchFindLimit))
+    {
+        const uchar *matchLimit = end - lastLiterals;
+        const uchar *searchLimit = end - matchFindLimit;
+        int misses = 0;
+
+        while (input < searchLimit)
+        {
+            quint32 sequence = read32(input);
+            quint32 hash = (sequence * 2654435761u) >> (32 - hashBits);
+            quint32 candidate = table[hash];
+            table[hash] = static_cast<quint32>(input - source) + 1;
+
+            // --- Table entries are positions plus one, zero means empty ---
+            const uchar *reference = candidate > 0 ? source + candidate - 1 : input;
+            bool found = candidate > 0
+                    && input - reference <= 65535
+                    && read32(reference) == sequence;
+
+            if (!found)
+            {
+                // --- Skip faster through data that does not compress ---
+                input += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            const uchar *matchEnd = input + minimumMatch;
+            const uchar *referenceEnd = reference + minimumMatch;
+            while (matchEnd < matchLimit && *matchEnd == *referenceEnd)
+            {
+                matchEnd++;
+                referenceEnd++;
+            }
+            while (input > anchor && reference > source && input[-1] == reference[-1])
+            {
+                input--;
+                reference--;
+            }
+
+            size_t literals = input - anchor;
+            size_t matchLength = matchEnd - input - minimumMatch;
+            size_t offset = input - reference;
+
+            uchar *token = output++;
+            *token = static_cast<uchar>(std::min<size_t>(literals, 15) << 4);
+            if (literals >= 15)
+            {
+                writeLength(output, literals - 15);
+            }
+            std::memcpy(output, anchor, literals);
+            output += literals;
+
+            *output++ = static_cast<uchar>(offset);
+            *output++ = static_cast<uchar>(offset >> 8);
+
+            *token |= static_cast<uchar>(std::min<size_t>(matchLength, 15));
+            if (matchLength >= 15)
+            {
+                writeLength(output, matchLength - 15);
+            }
+
+            input = matchEnd;
+            anchor = input;
+        }
+    }
+
+    // --- Trailing literals close the block ---
+    size_t literals = end - anchor;
+    *output++ = static_cast<uchar>(std::min<size_t>(literals, 15) << 4);
+    if (literals >= 15)
+    {
+        writeLength(output, literals - 15);
+    }
+    std::memcpy(output, anchor, literals);
+    output += literals;
+
+    return output - destination;
+}
+
+bool lz4Decompress(const uchar *source, size_t length, uchar *destination, size_t expected)
+{
+    const uchar *input = source;
+    const uchar *inputEnd = source + length;
+    uchar *output = destination;
+    uchar *outputEnd = destination + expected;
+
+    while (input < inputEnd)
+    {
+        uchar token = *input++;
+
+        size_t literals = token >> 4;
+        if (literals == 15)
+        {
+            uchar extra;
+            do
+            {
+                if (input >= inputEnd) return false;
+                extra = *input++;
+                literals += extra;
+            } while (extra == 255);
+        }
+        if (literals > static_cast<size_t>(inputEnd - input)
+                || literals > static_cast<size_t>(outputEnd - output))
+        {
+            return false;
+        }
+        std::memcpy(output, input, literals);
+        input += literals;
+        output += literals;
+
+        if (input >= inputEnd)
+        {
+            break;
+        }
+
+        if (inputEnd - input < 2) return false;
+        size_t offset = input[0] | (input[1] << 8);
+        input += 2;
+        if (offset == 0 || offset > static_cast<size_t>(output - destination)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            uchar extra;
+            do
+            {
+                if (input >= inputEnd) return false;
+                extra = *input++;
+                matchLength += extra;
+            } while (extra == 255);
+        }
+        matchLength += minimumMatch;
+        if (matchLength > static_cast<size_t>(outputEnd - output)) return false;
+
+        // --- Matches may overlap their own output, copy forwards ---
+        const uchar *match = output - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(output, match, matchLength);
+            output += matchLength;
+        }
+        else
+        {
+            for (size_t index=0; index < matchLength; index++)
+            {
+                *output++ = *match++;
+            }
+        }
+    }
+    return output == outputEnd;
+}
+
+// ----- Tile Encoding --------------------------------------------------------
+class TileEncoder : public cv::ParallelLoopBody
+{
+public:
+    TileEncoder(const cv::Mat& inputImage,
+                int tileEdge,
+                TiledImageFile::Codec tileCodec,
+                std::vector< std::vector<uchar> >& tileOutputs)
+        : input(inputImage), edge(tileEdge), codec(tileCodec), outputs(tileOutputs)
+    {
+        across = (input.cols + edge - 1) / edge;
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        std::vector<uchar> packed;
+
+        for (int index=range.start; index < range.end; index++)
+        {
+            int x = (index % across) * edge;
+            int y = (index / across) * edge;
+            cv::Rect rect(x, y, std::min(edge, input.cols - x), std::min(edge, input.rows - y));
+
+            // --- Tile rows packed back to back ---
+            size_t rowBytes = rect.width * input.elemSize();
+            packed.resize(rowBytes * rect.height);
+            for (int row=0; row < rect.height; row++)
+            {
+                std::memcpy(&packed[row * rowBytes], input.ptr<uchar>(y + row) + x * input.elemSize(), rowBytes);
+            }
+
+            std::vector<uchar>& output = outputs[index];
+            if (codec == TiledImageFile::LZ4Codec)
+            {
+                output.resize(lz4Bound(packed.size()));
+                output.resize(lz4Compress(&packed[0], packed.size(), &output[0]));
+            }
+
+            // --- Stored raw when compression does not pay; stored == raw marks it ---
+            if (codec == TiledImageFile::RawCodec || output.size() >= packed.size())
+            {
+                output.swap(packed);
+            }
+        }
+    }
+
+private:
+    const cv::Mat& input;
+    int edge;
+    TiledImageFile::Codec codec;
+    std::vector< std::vector<uchar> >& outputs;
+    int across;
+};
+
+}
+
+// ----- Parallel Decode ------------------------------------------------------
+class TiledImageFile::ParallelDecode : public cv::ParallelLoopBody
+{
+public:
+    ParallelDecode(const TiledImageFile& tiledFile, cv::Mat& outputImage, QAtomicInt& decodeFailed)
+        : owner(tiledFile), output(outputImage), failed(decodeFailed) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int index=range.start; index < range.end; index++)
+        {
+            cv::Mat target = output(owner.tileRect(index % owner.tilesAcross(),
+                                                   index / owner.tilesAcross()));
+            if (!owner.decodeTile(index, target))
+            {
+                failed.store(1);
+            }
+        }
+    }
+
+private:
+    const TiledImageFile& owner;
+    cv::Mat& output;
+    QAtomicInt& failed;
+};
+
+// ----- Constructor / Destructor ---------------------------------------------
+TiledImageFile::TiledImageFile()
+{
+    data = 0;
+    dataSize = 0;
+    imageWidth = 0;
+    imageHeight = 0;
+    imageType = 0;
+    tileEdge = defaultTileSize;
+    std::memset(order, 0, sizeof(order));
+}
+
+TiledImageFile::~TiledImageFile()
+{
+    close();
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool TiledImageFile::isOpen() const
+{
+    return data != 0;
+}
+
+int TiledImageFile::width() const
+{
+    return imageWidth;
+}
+
+int TiledImageFile::height() const
+{
+    return imageHeight;
+}
+
+int TiledImageFile::type() const
+{
+    return imageType;
+}
+
+int TiledImageFile::tileSize() const
+{
+    return tileEdge;
+}
+
+int TiledImageFile::tilesAcross() const
+{
+    return (imageWidth + tileEdge - 1) / tileEdge;
+}
+
+int TiledImageFile::tilesDown() const
+{
+    return (imageHeight + tileEdge - 1) / tileEdge;
+}
+
+QString TiledImageFile::channelOrder() const
+{
+    return QString::fromLatin1(order, static_cast<int>(strnlen(order, sizeof(order))));
+}
+
+cv::Rect TiledImageFile::tileRect(int tileX, int tileY) const
+{
+    int x = tileX * tileEdge;
+    int y = tileY * tileEdge;
+    return cv::Rect(x, y, std::min(tileEdge, imageWidth - x), std::min(tileEdge, imageHeight - y));
+}
+
+bool TiledImageFile::readTile(int tileX, int tileY, cv::Mat& tile) const
+{
+    if (!isOpen() || tileX < 0 || tileY < 0 || tileX >= tilesAcross() || tileY >= tilesDown())
+    {
+        return false;
+    }
+
+    cv::Rect rect = tileRect(tileX, tileY);
+    tile.create(rect.height, rect.width, imageType);
+    return decodeTile(tileY * tilesAcross() + tileX, tile);
+}
+
+// --- Decode only the tiles that overlap the region ---
+bool TiledImageFile::readRegion(cv::Rect region, cv::Mat& output) const
+{
+    region &= cv::Rect(0, 0, imageWidth, imageHeight);
+    if (!isOpen() || region.area() == 0)
+    {
+        return false;
+    }
+
+    output.create(region.height, region.width, imageType);
+
+    cv::Mat tile;
+    for (int tileY = region.y / tileEdge; tileY <= (region.br().y - 1) / tileEdge; tileY++)
+    {
+        for (int tileX = region.x / tileEdge; tileX <= (region.br().x - 1) / tileEdge; tileX++)
+        {
+            cv::Rect rect = tileRect(tileX, tileY);
+            cv::Rect overlap = rect & region;
+
+            if (overlap == rect)
+            {
+                cv::Mat target = output(rect - region.tl());
+                if (!decodeTile(tileY * tilesAcross() + tileX, target))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if (!readTile(tileX, tileY, tile))
+            {
+                return false;
+            }
+            tile(overlap - rect.tl()).copyTo(output(overlap - region.tl()));
+        }
+    }
+    return true;
+}
+
+bool TiledImageFile::readImage(cv::Mat& image) const
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    image.create(imageHeight, imageWidth, imageType);
+
+    QAtomicInt failed(0);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())),
+                      ParallelDecode(*this, image, failed));
+    return failed.load() == 0;
+}
+
+bool TiledImageFile::decodeTile(int index, cv::Mat& target) const
+{
+    const TileEntry& entry = tiles[index];
+    const uchar *stored = data + entry.offset;
+    size_t rowBytes = target.cols * target.elemSize();
+
+    if (entry.storedBytes == entry.rawBytes)
+    {
+        for (int row=0; row < target.rows; row++)
+        {
+            std::memcpy(target.ptr<uchar>(row), stored + row * rowBytes, rowBytes);
+        }
+        return true;
+    }
+
+    if (target.isContinuous())
+    {
+        return lz4Decompress(stored, entry.storedBytes, target.ptr<uchar>(0), entry.rawBytes);
+    }
+
+    // --- Tiles inside a larger image are not contiguous, go through scratch ---
+    std::vector<uchar> scratch(entry.rawBytes);
+    if (!lz4Decompress(stored, entry.storedBytes, &scratch[0], entry.rawBytes))
+    {
+        return false;
+    }
+    for (int row=0; row < target.rows; row++)
+    {
+        std::memcpy(target.ptr<uchar>(row), &scratch[row * rowBytes], rowBytes);
+    }
+    return true;
+}
+
+// ----- Mutators -------------------------------------------------------------
+bool TiledImageFile::open(QString filePath, QString *errorString)
+{
+    close();
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorString) *errorString = QString("Cannot open ") + filePath;
+        return false;
+    }
+
+    // --- Map the file, or read it whole where mapping is unavailable ---
+    dataSize = file.size();
+    data = file.map(0, dataSize);
+    if (!data)
+    {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
+
+    if (dataSize < headerBytes || std::memcmp(data, fileMagic, sizeof(fileMagic)) != 0
+            || qFromLittleEndian<quint16>(data + 4) > fileVersion)
+    {
+        if (errorString) *errorString = QString("Not a tiled work image: ") + filePath;
+        close();
+        return false;
+    }
+
+    // --- Sizes are checked in 64 bits before anything is derived from them ---
+    quint32 storedWidth = qFromLittleEndian<quint32>(data + 8);
+    quint32 storedHeight = qFromLittleEndian<quint32>(data + 12);
+    quint32 storedEdge = qFromLittleEndian<quint32>(data + 24);
+    imageType = qFromLittleEndian<qint32>(data + 16);
+    std::memcpy(order, data + 20, sizeof(order));
+    quint32 tileCount = qFromLittleEndian<quint32>(data + 32);
+
+    bool bounded = storedWidth > 0 && storedWidth <= static_cast<quint32>(maximumDimension)
+            && storedHeight > 0 && storedHeight <= static_cast<quint32>(maximumDimension)
+            && storedEdge > 0 && storedEdge <= static_cast<quint32>(maximumTileSize);
+    quint64 expectedTiles = bounded
+            ? static_cast<quint64>((storedWidth + storedEdge - 1) / storedEdge)
+              * ((storedHeight + storedEdge - 1) / storedEdge)
+            : 0;
+
+    if (!bounded || !isSupported(imageType)
+            || tileCount != expectedTiles
+            || static_cast<quint64>(dataSize) < headerBytes + static_cast<quint64>(tileCount) * entryBytes)
+    {
+        if (errorString) *errorString = QString("Corrupt tiled work image header: ") + filePath;
+        close();
+        return false;
+    }
+    imageWidth = static_cast<int>(storedWidth);
+    imageHeight = static_cast<int>(storedHeight);
+    tileEdge = static_cast<int>(storedEdge);
+
+    // --- Every index entry has to point inside the file and match its tile; ---
+    // --- LZ4 expands at most 255-fold, so the decoded image is bounded by the file ---
+    quint64 elementBytes = CV_ELEM_SIZE(imageType);
+    tiles.resize(tileCount);
+    for (quint32 index=0; index < tileCount; index++)
+    {
+        const uchar *entry = data + headerBytes + static_cast<quint64>(index) * entryBytes;
+        tiles[index].offset = qFromLittleEndian<quint64>(entry);
+        tiles[index].storedBytes = qFromLittleEndian<quint32>(entry + 8);
+        tiles[index].rawBytes = qFromLittleEndian<quint32>(entry + 12);
+
+        cv::Rect rect = tileRect(index % tilesAcross(), index / tilesAcross());
+        quint64 rawBytes = static_cast<quint64>(rect.area()) * elementBytes;
+        quint64 storedBytes = tiles[index].storedBytes;
+        if (tiles[index].rawBytes != rawBytes
+                || storedBytes > rawBytes
+                || storedBytes * lz4MaximumRatio + 64 < rawBytes
+                || tiles[index].offset > static_cast<quint64>(dataSize)
+                || storedBytes > static_cast<quint64>(dataSize) - tiles[index].offset)
+        {
+            if (errorString) *errorString = QString("Corrupt tiled work image index: ") + filePath;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TiledImageFile::close()
+{
+    if (data && contents.isEmpty())
+    {
+        file.unmap(const_cast<uchar*>(data));
+    }
+    file.close();
+
+    contents.clear();
+    tiles.clear();
+    data = 0;
+    dataSize = 0;
+}
+
+// ----- Factories ------------------------------------------------------------
+bool TiledImageFile::isTiledFile(QString filePath)
+{
+    return QFileInfo(filePath).suffix().toLower() == "ict";
+}
+
+// --- 8-bit, 16-bit or float with 1, 3 or 4 channels, as labelled in the header ---
+bool TiledImageFile::isSupported(int type)
+{
+    int depth = CV_MAT_DEPTH(type);
+    int channels = CV_MAT_CN(type);
+    return type == CV_MAKETYPE(depth, channels)
+            && (depth == CV_8U || depth == CV_16U || depth == CV_32F)
+            && (channels == 1 || channels == 3 || channels == 4);
+}
+
+bool TiledImageFile::save(QString filePath,
+                          const cv::Mat& image,
+                          Codec codec,
+                          int tileSize,
+                          QString *errorString)
+{
+    if (image.empty() || tileSize <= 0)
+    {
+        if (errorString) *errorString = QString("Nothing to save");
+        return false;
+    }
+
+    // --- The index has to fit one QByteArray ---
+    int across = (image.cols + tileSize - 1) / tileSize;
+    int down = (image.rows + tileSize - 1) / tileSize;
+    qint64 totalTiles = static_cast<qint64>(across) * down;
+
+    if (!isSupported(image.type()) || tileSize > maximumTileSize
+            || image.cols > maximumDimension || image.rows > maximumDimension
+            || totalTiles > (std::numeric_limits<int>::max() - headerBytes) / entryBytes)
+    {
+        if (errorString) *errorString = QString("Unsupported work image type or size");
+        return false;
+    }
+    int tileCount = static_cast<int>(totalTiles);
+
+    std::vector< std::vector<uchar> > outputs(tileCount);
+    cv::parallel_for_(cv::Range(0, tileCount), TileEncoder(image, tileSize, codec, outputs));
+
+    // --- Header and index, then the tiles in row-major order ---
+    QByteArray header(headerBytes + tileCount * entryBytes, '\0');
+    uchar *head = reinterpret_cast<uchar*>(header.data());
+
+    const char *channels = image.channels() == 1 ? "GRAY" : (image.channels() == 4 ? "BGRA" : "BGR");
+    std::memcpy(head, fileMagic, sizeof(fileMagic));
+    qToLittleEndian<quint16>(fileVersion, head + 4);
+    qToLittleEndian<quint32>(image.cols, head + 8);
+    qToLittleEndian<quint32>(image.rows, head + 12);
+    qToLittleEndian<qint32>(image.type(), head + 16);
+    std::memcpy(head + 20, channels, strlen(channels));
+    qToLittleEndian<quint32>(tileSize, head + 24);
+    qToLittleEndian<quint32>(codec, head + 28);
+    qToLittleEndian<quint32>(tileCount, head + 32);
+
+    quint64 offset = header.size();
+    for (int index=0; index < tileCount; index++)
+    {
+        int width = std::min(tileSize, image.cols - (index % across) * tileSize);
+        int height = std::min(tileSize, image.rows - (index / across) * tileSize);
+        uchar *entry = head + headerBytes + index * entryBytes;
+
+        qToLittleEndian<quint64>(offset, entry);
+        qToLittleEndian<quint32>(static_cast<quint32>(outputs[index].size()), entry + 8);
+        qToLittleEndian<quint32>(static_cast<quint32>(width * height * image.elemSize()), entry + 12);
+        offset += outputs[index].size();
+    }
+
+    QFile output(filePath);
+    if (!output.open(QIODevice::WriteOnly) || output.write(header) != header.size())
+    {
+        if (errorString) *errorString = QString("Cannot write ") + filePath;
+        return false;
+    }
+    for (int index=0; index < tileCount; index++)
+    {
+        qint64 length = static_cast<qint64>(outputs[index].size());
+        if (output.write(reinterpret_cast<const char*>(&outputs[index][0]), length) != length)
+        {
+            if (errorString) *errorString = QString("Cannot write ") + filePath;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TiledImageFile::load(QString filePath, cv::Mat& image, QString *errorString)
+{
+    TiledImageFile tiledFile;
+
+    if (!tiledFile.open(filePath, errorString))
+    {
+        return false;
+    }
+    if (!tiledFile.readImage(image))
+    {
+        if (errorString) *errorString = QString("Corrupt tile in ") + filePath;
+        return false;
+    }
+    return true;
+}
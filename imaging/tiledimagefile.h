@@ -0,0 +1,91 @@
+#ifndef TILEDIMAGEFILE_H
+#define TILEDIMAGEFILE_H
+
+#include <vector>
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+// --- Lossless tiled container for intermediate work images (.ict). ---
+// A fixed little-endian header (size, cv type, channel order, tile size and
+// codec) is followed by a tile index and the tiles themselves, each stored raw
+// or as an LZ4 block, whichever is smaller. Files are memory-mapped on open and
+// tiles decode independently, so a region can be read without touching the
+// rest of the file and a whole image decodes on every core. Only 8-bit, 16-bit
+// and float images with 1, 3 or 4 channels are written or read back.
+class TiledImageFile
+{
+public:
+    enum Codec
+    {
+        RawCodec = 0,
+        LZ4Codec = 1
+    };
+
+    static const int defaultTileSize = 256;
+    static const int maximumTileSize = 4096;
+    static const int maximumDimension = 1 << 20;
+
+    // --- Constructor / Destructor ---
+    TiledImageFile();
+    ~TiledImageFile();
+
+    // --- Accessors ---
+    bool isOpen() const;
+    int width() const;
+    int height() const;
+    int type() const;
+    int tileSize() const;
+    int tilesAcross() const;
+    int tilesDown() const;
+    QString channelOrder() const;
+    cv::Rect tileRect(int tileX, int tileY) const;
+
+    bool readTile(int tileX, int tileY, cv::Mat& tile) const;
+    bool readRegion(cv::Rect region, cv::Mat& output) const;
+    bool readImage(cv::Mat& image) const;
+
+    // --- Mutators ---
+    bool open(QString filePath, QString *errorString = 0);
+    void close();
+
+    // --- Factories ---
+    static bool isTiledFile(QString filePath);
+    static bool isSupported(int type);
+    static bool save(QString filePath,
+                     const cv::Mat& image,
+                     Codec codec = LZ4Codec,
+                     int tileSize = defaultTileSize,
+                     QString *errorString = 0);
+    static bool load(QString filePath, cv::Mat& image, QString *errorString = 0);
+
+private:
+    struct TileEntry
+    {
+        quint64 offset;
+        quint32 storedBytes;
+        quint32 rawBytes;
+    };
+
+    QFile file;
+    const uchar *data;      // mapped file, or contents when mapping failed
+    QByteArray contents;
+    qint64 dataSize;
+
+    int imageWidth;
+    int imageHeight;
+    int imageType;
+    int tileEdge;
+    char order[4];
+    std::vector<TileEntry> tiles;
+
+    class ParallelDecode;
+
+    bool decodeTile(int index, cv::Mat& target) const;
+};
+
+#endif // TILEDIMAGEFILE_H
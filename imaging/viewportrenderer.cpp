@@ -0,0 +1,201 @@
+#include "viewportrenderer.h"
+
+#include <algorithm>
+
+#include <QMetaObject>
+#include <QRunnable>
+
+#include <opencv2/core/utility.hpp>
+
+#include "myimage.h"
+
+namespace {
+
+typedef std::pair<qint64, cv::Rect> DistantTile;
+
+bool nearerFirst(const DistantTile& a, const DistantTile& b)
+{
+    return a.first < b.first;
+}
+
+}
+
+// ----- Tile Passes ----------------------------------------------------------
+// --- One tile per index, all writing disjoint parts of the target ---
+class ViewportRenderer::ParallelTiles : public cv::ParallelLoopBody
+{
+public:
+    ParallelTiles(const ViewportRenderer& owner, const std::vector<cv::Rect>& tileRects, int first)
+        : renderer(owner), tiles(tileRects), offset(first) {}
+
+    void operator()(const cv::Range& range) const
+    {
+        cv::Mat target = renderer.target;
+        for (int index=range.start; index < range.end; index++)
+        {
+            MyImage::applyChannelLUTRect(renderer.source, target, renderer.table,
+                                         renderer.mask, tiles[offset + index]);
+        }
+    }
+
+private:
+    const ViewportRenderer& renderer;
+    const std::vector<cv::Rect>& tiles;
+    int offset;
+};
+
+// --- Off-screen tiles in batches, checking for a newer frame in between ---
+class ViewportRenderer::RemainingTiles : public QRunnable
+{
+public:
+    RemainingTiles(ViewportRenderer& owner, int frameGeneration)
+        : renderer(owner), generation(frameGeneration) {}
+
+    void run()
+    {
+        const std::vector<cv::Rect>& tiles = renderer.remaining;
+        int batch = std::max(1, 2 * cv::getNumThreads());
+
+        for (int first=0; first < static_cast<int>(tiles.size()); first += batch)
+        {
+            if (renderer.current.load() != generation)
+            {
+                return;
+            }
+
+            int count = std::min(batch, static_cast<int>(tiles.size()) - first);
+            cv::parallel_for_(cv::Range(0, count), ParallelTiles(renderer, tiles, first));
+        }
+
+        QMetaObject::invokeMethod(&renderer, "jobFinished", Qt::QueuedConnection,
+                                  Q_ARG(int, generation));
+    }
+
+private:
+    ViewportRenderer& renderer;
+    int generation;
+};
+
+// ----- Constructor / Destructor ---------------------------------------------
+ViewportRenderer::ViewportRenderer(QObject *parent) :
+    QObject(parent)
+{
+    // --- One frame at a time, the batches are parallel inside ---
+    pool.setMaxThreadCount(1);
+}
+
+ViewportRenderer::~ViewportRenderer()
+{
+    cancel();
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool ViewportRenderer::isRendering() const
+{
+    return rendering.load() != 0;
+}
+
+int ViewportRenderer::generation() const
+{
+    return current.load();
+}
+
+const cv::Mat& ViewportRenderer::result() const
+{
+    return target;
+}
+
+// --- Only when zoomed in on a large 8-bit frame; otherwise map it all at once ---
+bool ViewportRenderer::isWorthwhile(const cv::Mat& inputImage, cv::Rect visible)
+{
+    visible &= cv::Rect(0, 0, inputImage.cols, inputImage.rows);
+    return inputImage.type() == CV_8UC3
+            && inputImage.total() >= (size_t(1) << 20)
+            && visible.area() > 0
+            && 2 * static_cast<size_t>(visible.area()) < inputImage.total();
+}
+
+// ----- Mutators -------------------------------------------------------------
+// --- Visible tiles are done when this returns; the rest follow in the pool ---
+int ViewportRenderer::start(const cv::Mat& inputImage,
+                            const cv::Mat& lut,
+                            const SelectionMask& selection,
+                            cv::Rect visible)
+{
+    cancel();
+
+    source = inputImage;
+    table = lut;
+    mask = selection;
+    target.create(inputImage.size(), inputImage.type());
+
+    // --- Split the grid into visible tiles and the rest, nearest first ---
+    cv::Rect image(0, 0, source.cols, source.rows);
+    visible &= image;
+    cv::Point centre(visible.x + visible.width / 2, visible.y + visible.height / 2);
+
+    std::vector<cv::Rect> onScreen;
+    std::vector<DistantTile> offScreen;
+    for (int y=0; y < source.rows; y += tileSize)
+    {
+        for (int x=0; x < source.cols; x += tileSize)
+        {
+            cv::Rect tile = cv::Rect(x, y, tileSize, tileSize) & image;
+            if ((tile & visible).area() > 0)
+            {
+                onScreen.push_back(tile);
+                continue;
+            }
+
+            qint64 dx = tile.x + tile.width / 2 - centre.x;
+            qint64 dy = tile.y + tile.height / 2 - centre.y;
+            offScreen.push_back(std::make_pair(dx * dx + dy * dy, tile));
+        }
+    }
+    std::sort(offScreen.begin(), offScreen.end(), nearerFirst);
+
+    if (!onScreen.empty())
+    {
+        cv::parallel_for_(cv::Range(0, static_cast<int>(onScreen.size())),
+                          ParallelTiles(*this, onScreen, 0));
+    }
+
+    remaining.clear();
+    for (size_t index=0; index < offScreen.size(); index++)
+    {
+        remaining.push_back(offScreen[index].second);
+    }
+
+    int frame = current.fetchAndAddOrdered(1) + 1;
+    rendering.store(1);
+    pool.start(new RemainingTiles(*this, frame));
+    return frame;
+}
+
+// --- Drop the unfinished frame; its tiles in the target are left as they are ---
+void ViewportRenderer::cancel()
+{
+    current.fetchAndAddOrdered(1);
+    pool.waitForDone();
+    rendering.store(0);
+}
+
+// --- Hand the finished frame over; the next start() maps into a new buffer ---
+cv::Mat ViewportRenderer::takeResult()
+{
+    cv::Mat frame = target;
+    target.release();
+    source.release();
+    return frame;
+}
+
+void ViewportRenderer::jobFinished(int finishedGeneration)
+{
+    if (finishedGeneration != current.load())
+    {
+        return;
+    }
+
+    rendering.store(0);
+    emit rendered(finishedGeneration);
+}
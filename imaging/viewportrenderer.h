@@ -0,0 +1,67 @@
+#ifndef VIEWPORTRENDERER_H
+#define VIEWPORTRENDERER_H
+
+#include <vector>
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThreadPool>
+
+#include <opencv2/core/core.hpp>
+
+#include "selectionmask.h"
+
+// --- Channel-LUT adjustment that maps what is on screen first. ---
+// start() maps the tiles under the visible rectangle before returning, so the
+// caller can show them at once, then maps the remaining tiles on a background
+// thread, nearest to the view first. rendered() is emitted on the owner's
+// thread when the whole frame is done; a new start() or cancel() drops the
+// unfinished frame, waiting at most for one batch of tiles.
+class ViewportRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int tileSize = 4 * SelectionMask::tileSize;
+
+    // --- Constructor / Destructor ---
+    explicit ViewportRenderer(QObject *parent = 0);
+    ~ViewportRenderer();
+
+    // --- Accessors ---
+    bool isRendering() const;
+    int generation() const;
+    const cv::Mat& result() const;
+
+    static bool isWorthwhile(const cv::Mat& inputImage, cv::Rect visible);
+
+    // --- Mutators ---
+    int start(const cv::Mat& inputImage,
+              const cv::Mat& lut,
+              const SelectionMask& selection,
+              cv::Rect visible);
+    void cancel();
+    cv::Mat takeResult();
+
+signals:
+    void rendered(int generation);
+
+private slots:
+    void jobFinished(int finishedGeneration);
+
+private:
+    class RemainingTiles;
+    class ParallelTiles;
+
+    QThreadPool pool;
+    QAtomicInt current;
+    QAtomicInt rendering;
+
+    cv::Mat source;
+    cv::Mat table;
+    cv::Mat target;
+    SelectionMask mask;
+    std::vector<cv::Rect> remaining;
+};
+
+#endif // VIEWPORTRENDERER_H
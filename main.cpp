@@ -1,9 +1,17 @@
 #include "mainwindow.h"
+#include "servicemain.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    if (isServiceMode(argc, argv))
+    {
+        return runService(argc, argv);
+    }
+
     QApplication a(argc, argv);
+    a.setOrganizationName("ImagingColors");
+    a.setApplicationName("ImagingColors");
     MainWindow w;
     w.show();
 
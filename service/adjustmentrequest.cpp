@@ -0,0 +1,141 @@
+#include "adjustmentrequest.h"
+
+#include <QStringList>
+
+#include "myimage.h"
+
+// ----- Constructor / Destructor ---------------------------------------------
+AdjustmentRequest::AdjustmentRequest()
+{
+}
+
+AdjustmentRequest::~AdjustmentRequest()
+{
+    // destructor call goes here
+}
+
+// ----- Accessors ------------------------------------------------------------
+// --- Writes into outputImage's buffer when it already has the right shape ---
+bool AdjustmentRequest::apply(const cv::Mat& inputImage, cv::Mat& outputImage) const
+{
+    if (inputImage.empty() || inputImage.type() != CV_8UC3)
+    {
+        return false;
+    }
+
+    MyImage worker("Request");
+    worker.image = outputImage;
+
+    const cv::Mat *source = &inputImage;
+    if (autoCorrection == "grayworld")
+    {
+        worker.autoWhiteBalanceGrayWorld(inputImage);
+        source = &worker.image;
+    }
+    else if (autoCorrection == "whitepatch")
+    {
+        worker.autoWhiteBalanceWhitePatch(inputImage);
+        source = &worker.image;
+    }
+    else if (autoCorrection == "levels")
+    {
+        worker.autoLevels(inputImage);
+        source = &worker.image;
+    }
+
+    worker.applyPreset(*source, compiled);
+    outputImage = worker.image;
+    return true;
+}
+
+// ----- Mutators -------------------------------------------------------------
+bool AdjustmentRequest::fromJson(const QJsonObject& object, QString *errorString)
+{
+    preset = AdjustmentPreset();
+
+    if (object.contains("preset"))
+    {
+        QString error;
+        preset = AdjustmentPreset::load(object["preset"].toString(), &error);
+        if (!error.isEmpty())
+        {
+            if (errorString) *errorString = error;
+            return false;
+        }
+    }
+
+    autoCorrection = object["auto"].toString().toLower();
+    if (!autoCorrection.isEmpty() && autoCorrection != "grayworld"
+            && autoCorrection != "whitepatch" && autoCorrection != "levels")
+    {
+        if (errorString) *errorString = QString("Unknown automatic correction: ") + autoCorrection;
+        return false;
+    }
+
+    if (object.contains("linearLight"))
+    {
+        preset.chain.setLinearLight(object["linearLight"].toBool());
+    }
+
+    // --- Identity steps are left out so they cannot force a 3D table ---
+    double red = object["red"].toDouble(1.0);
+    double green = object["green"].toDouble(1.0);
+    double blue = object["blue"].toDouble(1.0);
+    if (red != 1.0 || green != 1.0 || blue != 1.0)
+    {
+        preset.chain.addGains(red, green, blue);
+    }
+
+    double hue = object["hue"].toDouble(0.0);
+    double saturation = object["saturation"].toDouble(1.0);
+    double intensity = object["intensity"].toDouble(1.0);
+    if (hue != 0.0 || saturation != 1.0 || intensity != 1.0)
+    {
+        preset.chain.addHSI(hue, saturation, intensity);
+    }
+
+    compiled = preset.compile();
+    return true;
+}
+
+// --- Same fields as fromJson, given as URL query items, except "preset": ---
+// --- queries come from the network and must not name local files ---
+bool AdjustmentRequest::fromQuery(const QUrlQuery& query, QString *errorString)
+{
+    static const QStringList numbers = QStringList()
+            << "red" << "green" << "blue" << "hue" << "saturation" << "intensity";
+
+    QJsonObject object;
+    QList< QPair<QString, QString> > items = query.queryItems(QUrl::FullyDecoded);
+
+    for (int index=0; index < items.size(); index++)
+    {
+        QString key = items.at(index).first;
+        QString value = items.at(index).second;
+
+        if (numbers.contains(key))
+        {
+            bool valid = false;
+            object[key] = value.toDouble(&valid);
+            if (!valid)
+            {
+                if (errorString) *errorString = QString("Not a number: ") + key;
+                return false;
+            }
+        }
+        else if (key == "linearLight")
+        {
+            object[key] = (value == "1" || value.toLower() == "true");
+        }
+        else if (key == "auto")
+        {
+            object[key] = value;
+        }
+        else if (key == "preset")
+        {
+            if (errorString) *errorString = QString("Presets cannot be loaded from a query");
+            return false;
+        }
+    }
+    return fromJson(object, errorString);
+}
@@ -0,0 +1,39 @@
+#ifndef ADJUSTMENTREQUEST_H
+#define ADJUSTMENTREQUEST_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QUrlQuery>
+
+#include <opencv2/core/core.hpp>
+
+#include "adjustmentpreset.h"
+
+// --- One adjustment as sent by a local client, shared by the service modes ---
+// Fields, all optional: "preset" (a .json or .cube file), "auto" (grayworld,
+// whitepatch or levels, run first since it depends on the image), RGB gains
+// "red" / "green" / "blue", HSI "hue" / "saturation" / "intensity" and
+// "linearLight". Everything but the automatic correction is compiled once on
+// parse, so applying a request is one table pass. Queries cannot name a
+// preset, only local callers of fromJson can.
+class AdjustmentRequest
+{
+public:
+    // --- Constructor / Destructor ---
+    AdjustmentRequest();
+    ~AdjustmentRequest();
+
+    // --- Members ---
+    AdjustmentPreset preset;
+    CompiledPreset compiled;
+    QString autoCorrection;
+
+    // --- Accessors ---
+    bool apply(const cv::Mat& inputImage, cv::Mat& outputImage) const;
+
+    // --- Mutators ---
+    bool fromJson(const QJsonObject& object, QString *errorString = 0);
+    bool fromQuery(const QUrlQuery& query, QString *errorString = 0);
+};
+
+#endif // ADJUSTMENTREQUEST_H
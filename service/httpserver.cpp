@@ -0,0 +1,521 @@
+#include "httpserver.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QList>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "adjustmentrequest.h"
+#include "imageexporter.h"
+
+namespace {
+
+const int maximumHeaderBytes = 64 * 1024;
+const qint64 maximumBodyBytes = 256 * 1024 * 1024;
+const qint64 maximumBufferBytes = maximumHeaderBytes + 4 + maximumBodyBytes;
+const int idleMilliseconds = 30000;
+
+QByteArray reasonPhrase(int status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 422: return "Unprocessable Entity";
+    case 431: return "Request Header Fields Too Large";
+    default:  return "Internal Server Error";
+    }
+}
+
+QByteArray errorBody(QString message)
+{
+    QJsonObject object;
+    object["error"] = message;
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+// --- Decode the upload, adjust it, encode the answer ---
+class HttpJob : public QRunnable
+{
+public:
+    HttpJob(QObject *jobOwner, int connection, const QUrlQuery& parameters, const QByteArray& upload)
+        : owner(jobOwner), query(parameters), body(upload)
+    {
+        result.connectionId = connection;
+        result.status = 200;
+        result.decodeMilliseconds = 0.0;
+        result.processMilliseconds = 0.0;
+        result.encodeMilliseconds = 0.0;
+    }
+
+    void run()
+    {
+        process();
+
+        QMetaObject::invokeMethod(owner, "jobFinished", Qt::QueuedConnection,
+                                  Q_ARG(HttpResult, result));
+    }
+
+private:
+    QObject *owner;
+    QUrlQuery query;
+    QByteArray body;
+    HttpResult result;
+
+    void fail(int status, QString message)
+    {
+        result.status = status;
+        result.contentType = "application/json";
+        result.body = errorBody(message);
+    }
+
+    void process()
+    {
+        // --- Everything in the query is checked before any pixel work ---
+        QString error;
+        AdjustmentRequest request;
+        if (!request.fromQuery(query, &error))
+        {
+            fail(400, error);
+            return;
+        }
+
+        QString effortName = query.queryItemValue("effort").toLower();
+        ExportOptions::Effort effort = ExportOptions::BalancedEffort;
+        if (effortName == "preview") effort = ExportOptions::PreviewEffort;
+        else if (effortName == "archival") effort = ExportOptions::ArchivalEffort;
+
+        QString formatName = query.hasQueryItem("format") ? query.queryItemValue("format") : QString("png");
+        ExportOptions options = ExportOptions::forEffort(
+                    effort, ExportOptions::formatForPath(QString("upload.") + formatName));
+        if (options.format == ExportOptions::RawFormat
+                || (options.format == ExportOptions::PNGFormat && formatName.toLower() != "png"))
+        {
+            fail(400, QString("Unsupported format: ") + formatName);
+            return;
+        }
+
+        if (query.hasQueryItem("quality"))
+        {
+            int quality = query.queryItemValue("quality").toInt();
+            options.jpegQuality = std::max(1, std::min(100, quality));
+            options.webpQuality = std::max(1, std::min(101, quality));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        cv::Mat encoded(1, body.size(), CV_8UC1, const_cast<char*>(body.constData()));
+        cv::Mat image = body.isEmpty() ? cv::Mat() : cv::imdecode(encoded, cv::IMREAD_COLOR);
+        body.clear();
+        result.decodeMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        if (image.empty())
+        {
+            fail(422, QString("Cannot decode the uploaded image"));
+            return;
+        }
+
+        timer.restart();
+        request.apply(image, image);
+        result.processMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        timer.restart();
+        std::vector<uchar> buffer;
+        if (!ImageExporter::encode(image, options, buffer, &error))
+        {
+            fail(500, error);
+            return;
+        }
+        result.encodeMilliseconds = timer.nsecsElapsed() / 1.0e6;
+
+        result.contentType = ImageExporter::mimeType(options.format).toLatin1();
+        result.body = QByteArray(reinterpret_cast<const char*>(&buffer[0]), static_cast<int>(buffer.size()));
+    }
+};
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+HttpServer::HttpServer(int workers, QObject *parent) :
+    QObject(parent)
+{
+    qRegisterMetaType<HttpResult>("HttpResult");
+
+    pool.setMaxThreadCount(std::max(1, workers));
+    nextConnectionId = 0;
+
+    requestCount = 0;
+    errorCount = 0;
+    stageCount = 0;
+    stageTotals[0] = 0.0;
+    stageTotals[1] = 0.0;
+    stageTotals[2] = 0.0;
+
+    connect(&server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+HttpServer::~HttpServer()
+{
+    pool.waitForDone();
+}
+
+// ----- Accessors ------------------------------------------------------------
+// --- Loopback only, the server has no authentication ---
+bool HttpServer::start(quint16 port)
+{
+    if (!server.listen(QHostAddress::LocalHost, port))
+    {
+        std::cout << "HTTP: " << server.errorString().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+quint16 HttpServer::port() const
+{
+    return server.serverPort();
+}
+
+QJsonObject HttpServer::metrics() const
+{
+    QJsonObject object;
+    object["requests"] = static_cast<double>(requestCount);
+    object["errors"] = static_cast<double>(errorCount);
+    object["inFlight"] = pool.activeThreadCount();
+
+    std::vector<double> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+
+    QJsonObject latency;
+    if (!sorted.empty())
+    {
+        double sum = 0.0;
+        for (size_t index=0; index < sorted.size(); index++)
+        {
+            sum += sorted[index];
+        }
+        latency["mean"] = sum / sorted.size();
+        latency["p50"] = sorted[sorted.size() / 2];
+        latency["p90"] = sorted[sorted.size() * 9 / 10];
+        latency["p99"] = sorted[sorted.size() * 99 / 100];
+        latency["max"] = sorted.back();
+    }
+    latency["window"] = static_cast<int>(sorted.size());
+    object["latencyMilliseconds"] = latency;
+
+    QJsonObject stages;
+    if (stageCount > 0)
+    {
+        stages["decode"] = stageTotals[0] / stageCount;
+        stages["process"] = stageTotals[1] / stageCount;
+        stages["encode"] = stageTotals[2] / stageCount;
+    }
+    object["meanStageMilliseconds"] = stages;
+
+    return object;
+}
+
+// ----- Connections ----------------------------------------------------------
+void HttpServer::acceptConnection()
+{
+    while (server.hasPendingConnections())
+    {
+        int connectionId = nextConnectionId++;
+
+        Connection connection;
+        connection.socket = server.nextPendingConnection();
+        connection.idleTimer = new QTimer(connection.socket);
+        connection.busy = false;
+        connection.keepAlive = true;
+
+        connection.socket->setProperty("connectionId", connectionId);
+        connection.idleTimer->setProperty("connectionId", connectionId);
+        connection.idleTimer->setSingleShot(true);
+        connection.idleTimer->start(idleMilliseconds);
+
+        connect(connection.socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(connection.socket, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+        connect(connection.idleTimer, SIGNAL(timeout()), this, SLOT(closeIdle()));
+
+        connections.insert(connectionId, connection);
+    }
+}
+
+void HttpServer::readRequests()
+{
+    int connectionId = sender()->property("connectionId").toInt();
+    if (!connections.contains(connectionId))
+    {
+        return;
+    }
+
+    Connection& connection = connections[connectionId];
+    connection.buffer.append(connection.socket->readAll());
+    connection.idleTimer->start(idleMilliseconds);
+
+    // --- Pipelined data keeps arriving while a job runs, so cap it here ---
+    if (connection.buffer.size() > maximumBufferBytes)
+    {
+        std::cout << "HTTP: dropping a connection that sent more than "
+                  << maximumBufferBytes << " bytes ahead" << std::endl;
+        connection.buffer.clear();
+        connection.socket->abort();
+        return;
+    }
+
+    processNext(connectionId);
+}
+
+void HttpServer::dropConnection()
+{
+    int connectionId = sender()->property("connectionId").toInt();
+    if (!connections.contains(connectionId))
+    {
+        return;
+    }
+
+    connections[connectionId].socket->deleteLater();
+    connections.remove(connectionId);
+}
+
+void HttpServer::closeIdle()
+{
+    int connectionId = sender()->property("connectionId").toInt();
+    if (connections.contains(connectionId) && !connections[connectionId].busy)
+    {
+        connections[connectionId].socket->disconnectFromHost();
+    }
+}
+
+// ----- Requests -------------------------------------------------------------
+// --- Answer buffered requests until one goes to the pool or is incomplete ---
+// A loop rather than respond() calling back in, so a client pipelining many
+// requests that are answered at once cannot grow the stack.
+void HttpServer::processNext(int connectionId)
+{
+    while (processRequest(connectionId))
+    {
+        if (!connections.contains(connectionId) || !connections[connectionId].keepAlive)
+        {
+            break;
+        }
+    }
+}
+
+// --- Parse one complete request off the buffer, if there is one ---
+// Returns true when it was answered here and the next one may follow.
+bool HttpServer::processRequest(int connectionId)
+{
+    Connection& connection = connections[connectionId];
+    if (connection.busy)
+    {
+        return false;
+    }
+
+    int headerEnd = connection.buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+    {
+        if (connection.buffer.size() > maximumHeaderBytes)
+        {
+            connection.busy = true;
+            connection.keepAlive = false;
+            connection.clock.start();
+            respond(connectionId, 431, "application/json", errorBody("Headers too large"));
+            return true;
+        }
+        return false;
+    }
+
+    QList<QByteArray> lines = connection.buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.at(0).trimmed().split(' ');
+
+    QHash<QByteArray, QByteArray> headers;
+    for (int index=1; index < lines.size(); index++)
+    {
+        int colon = lines.at(index).indexOf(':');
+        if (colon > 0)
+        {
+            headers.insert(lines.at(index).left(colon).trimmed().toLower(),
+                           lines.at(index).mid(colon + 1).trimmed());
+        }
+    }
+
+    connection.busy = true;
+    connection.clock.start();
+
+    if (requestLine.size() != 3 || !requestLine.at(2).startsWith("HTTP/1."))
+    {
+        connection.keepAlive = false;
+        respond(connectionId, 400, "application/json", errorBody("Malformed request line"));
+        return true;
+    }
+
+    // --- HTTP/1.1 stays open unless told otherwise, HTTP/1.0 the reverse ---
+    QByteArray connectionHeader = headers.value("connection").toLower();
+    connection.method = requestLine.at(0);
+    connection.target = requestLine.at(1);
+    connection.keepAlive = requestLine.at(2) == "HTTP/1.1" ? connectionHeader != "close"
+                                                           : connectionHeader == "keep-alive";
+
+    if (headers.contains("transfer-encoding"))
+    {
+        connection.keepAlive = false;
+        respond(connectionId, 411, "application/json", errorBody("Send a Content-Length"));
+        return true;
+    }
+
+    bool valid = true;
+    qint64 contentLength = headers.contains("content-length")
+            ? headers.value("content-length").toLongLong(&valid) : 0;
+    if (!valid || contentLength < 0)
+    {
+        connection.keepAlive = false;
+        respond(connectionId, 400, "application/json", errorBody("Bad Content-Length"));
+        return true;
+    }
+    if (contentLength > maximumBodyBytes)
+    {
+        connection.keepAlive = false;
+        respond(connectionId, 413, "application/json", errorBody("Image too large"));
+        return true;
+    }
+
+    // --- Wait for the rest of the body ---
+    if (connection.buffer.size() < headerEnd + 4 + contentLength)
+    {
+        connection.busy = false;
+        return false;
+    }
+
+    QByteArray body = connection.buffer.mid(headerEnd + 4, static_cast<int>(contentLength));
+    connection.buffer.remove(0, headerEnd + 4 + static_cast<int>(contentLength));
+
+    QUrl url(QString::fromLatin1(connection.target));
+    QString path = url.path();
+
+    if (path == "/metrics" && connection.method == "GET")
+    {
+        respond(connectionId, 200, "application/json",
+                QJsonDocument(metrics()).toJson(QJsonDocument::Compact));
+    }
+    else if (path == "/adjust" && connection.method == "POST")
+    {
+        pool.start(new HttpJob(this, connectionId, QUrlQuery(url), body));
+        return false;
+    }
+    else if (path == "/" && connection.method == "GET")
+    {
+        respond(connectionId, 200, "text/plain",
+                "POST /adjust?red=&green=&blue=&hue=&saturation=&intensity="
+                "&auto=&linearLight=&format=&effort=&quality=  (body: image)\n"
+                "  auto: grayworld, whitepatch or levels\n"
+                "  format: png, jpg, webp or tiff; effort: preview, balanced or archival\n"
+                "  presets cannot be loaded over HTTP\n"
+                "GET /metrics\n");
+    }
+    else if (path == "/metrics" || path == "/adjust" || path == "/")
+    {
+        respond(connectionId, 405, "application/json", errorBody("Method not allowed"));
+    }
+    else
+    {
+        respond(connectionId, 404, "application/json", errorBody("No such endpoint"));
+    }
+    return true;
+}
+
+void HttpServer::jobFinished(HttpResult result)
+{
+    if (!connections.contains(result.connectionId))
+    {
+        return;
+    }
+
+    QByteArray timing = QString("decode;dur=%1, process;dur=%2, encode;dur=%3")
+            .arg(result.decodeMilliseconds, 0, 'f', 2)
+            .arg(result.processMilliseconds, 0, 'f', 2)
+            .arg(result.encodeMilliseconds, 0, 'f', 2).toLatin1();
+
+    if (result.status == 200)
+    {
+        stageTotals[0] += result.decodeMilliseconds;
+        stageTotals[1] += result.processMilliseconds;
+        stageTotals[2] += result.encodeMilliseconds;
+        stageCount++;
+    }
+
+    respond(result.connectionId, result.status, result.contentType, result.body, timing);
+
+    // --- Pipelined requests already in the buffer go next ---
+    if (connections.contains(result.connectionId) && connections[result.connectionId].keepAlive)
+    {
+        processNext(result.connectionId);
+    }
+}
+
+void HttpServer::respond(int connectionId,
+                         int status,
+                         QByteArray contentType,
+                         QByteArray body,
+                         QByteArray timing)
+{
+    Connection& connection = connections[connectionId];
+
+    QByteArray header = "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+    header += "Content-Type: " + contentType + "\r\n";
+    header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    header += connection.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if (!timing.isEmpty())
+    {
+        header += "Server-Timing: " + timing + "\r\n";
+    }
+    header += "\r\n";
+
+    connection.socket->write(header);
+    connection.socket->write(body);
+
+    double latency = connection.clock.nsecsElapsed() / 1.0e6;
+    record(latency, status);
+    std::cout << connection.method.constData() << " " << connection.target.constData() << " "
+              << status << " " << latency << " ms" << std::endl;
+
+    connection.busy = false;
+    if (!connection.keepAlive)
+    {
+        connection.socket->disconnectFromHost();
+        return;
+    }
+
+    connection.idleTimer->start(idleMilliseconds);
+}
+
+void HttpServer::record(double latency, int status)
+{
+    if (latencies.size() < static_cast<size_t>(latencyWindow))
+    {
+        latencies.push_back(latency);
+    }
+    else
+    {
+        latencies[requestCount % latencyWindow] = latency;
+    }
+
+    requestCount++;
+    if (status >= 400)
+    {
+        errorCount++;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThreadPool>
+#include <QTimer>
+
+// --- Outcome of one request, handed from a worker back to the server ---
+struct HttpResult
+{
+    int connectionId;
+    int status;
+    QByteArray contentType;
+    QByteArray body;
+    double decodeMilliseconds;
+    double processMilliseconds;
+    double encodeMilliseconds;
+};
+
+Q_DECLARE_METATYPE(HttpResult)
+
+// --- Minimal HTTP/1.1 server on 127.0.0.1 for scripted adjustments. ---
+//   POST /adjust?red=1.1&hue=0.02&format=jpg   body: an encoded image
+//   GET  /metrics                              latency and stage timings
+// The query takes AdjustmentRequest fields plus "format" (png, jpg, webp,
+// tiff), "effort" (preview, balanced, archival) and "quality", but no
+// "preset", which would open local files for any client. Connections
+// are kept alive and parsed on the server thread; decode, adjust and encode
+// run on the worker pool, one request per connection at a time. Every
+// response carries a Server-Timing header with its stage times. A connection
+// that buffers more than one maximal request is dropped, busy or not.
+class HttpServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int latencyWindow = 1024;     // requests kept for percentiles
+
+    // --- Constructor / Destructor ---
+    HttpServer(int workers, QObject *parent = 0);
+    ~HttpServer();
+
+    // --- Accessors ---
+    bool start(quint16 port);
+    quint16 port() const;
+    QJsonObject metrics() const;
+
+private slots:
+    void acceptConnection();
+    void readRequests();
+    void dropConnection();
+    void closeIdle();
+    void jobFinished(HttpResult result);
+
+private:
+    struct Connection
+    {
+        QTcpSocket *socket;
+        QTimer *idleTimer;
+        QByteArray buffer;
+        bool busy;
+        bool keepAlive;
+        QByteArray method;
+        QByteArray target;
+        QElapsedTimer clock;
+    };
+
+    QTcpServer server;
+    QThreadPool pool;
+    QHash<int, Connection> connections;
+    int nextConnectionId;
+
+    // --- Metrics ---
+    qint64 requestCount;
+    qint64 errorCount;
+    std::vector<double> latencies;
+    double stageTotals[3];     // decode, process, encode, milliseconds
+    qint64 stageCount;
+
+    void processNext(int connectionId);
+    bool processRequest(int connectionId);
+    void respond(int connectionId,
+                 int status,
+                 QByteArray contentType,
+                 QByteArray body,
+                 QByteArray timing = QByteArray());
+    void record(double latency, int status);
+};
+
+#endif // HTTPSERVER_H
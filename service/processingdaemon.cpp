@@ -0,0 +1,405 @@
+#include "processingdaemon.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QMetaObject>
+#include <QRunnable>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "adjustmentrequest.h"
+
+namespace {
+
+const int maximumLineBytes = 1 << 20;
+
+// --- A client's POSIX shared memory segment mapped as a cv::Mat ---
+class SharedImage
+{
+public:
+    SharedImage() : address(0), length(0) {}
+
+    ~SharedImage()
+    {
+#ifdef Q_OS_UNIX
+        if (address)
+        {
+            munmap(address, length);
+        }
+#endif
+    }
+
+    bool attach(const QJsonObject& description, QString *errorString)
+    {
+        QString name = description["shm"].toString();
+        int width = description["width"].toInt();
+        int height = description["height"].toInt();
+        int type = description["type"].toInt(CV_8UC3);
+        double stepValue = description["step"].toDouble(0);
+        double offsetValue = description["offset"].toDouble(0);
+
+        if (name.isEmpty() || width <= 0 || height <= 0)
+        {
+            *errorString = QString("Image needs shm, width and height");
+            return false;
+        }
+        if (type != CV_8UC3)
+        {
+            *errorString = QString("Images must be 8-bit BGR");
+            return false;
+        }
+
+        // --- Client numbers are checked before any size is computed from them ---
+        const double largest = 281474976710656.0;   // 2^48
+        if (!(stepValue >= 0.0 && stepValue < largest && offsetValue >= 0.0 && offsetValue < largest))
+        {
+            *errorString = QString("Image step and offset must be non-negative byte counts");
+            return false;
+        }
+
+        size_t rowBytes = static_cast<size_t>(width) * 3;
+        size_t step = static_cast<size_t>(stepValue);
+        size_t offset = static_cast<size_t>(offsetValue);
+        if (step == 0)
+        {
+            step = rowBytes;
+        }
+        if (step < rowBytes)
+        {
+            *errorString = QString("Image step is shorter than a row");
+            return false;
+        }
+        if (static_cast<size_t>(height - 1) > (std::numeric_limits<size_t>::max() - offset - rowBytes) / step)
+        {
+            *errorString = QString("Image does not fit in memory");
+            return false;
+        }
+
+#ifdef Q_OS_UNIX
+        int descriptor = shm_open(name.toLocal8Bit().constData(), O_RDWR, 0);
+        if (descriptor < 0)
+        {
+            *errorString = QString("Cannot open shared memory ") + name;
+            return false;
+        }
+
+        // --- The segment must hold every row the header describes ---
+        struct stat info;
+        size_t needed = offset + step * (height - 1) + rowBytes;
+        if (fstat(descriptor, &info) != 0 || static_cast<size_t>(info.st_size) < needed)
+        {
+            ::close(descriptor);
+            *errorString = QString("Shared memory is smaller than the image: ") + name;
+            return false;
+        }
+
+        length = info.st_size;
+        address = mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        ::close(descriptor);
+
+        if (address == MAP_FAILED)
+        {
+            address = 0;
+            *errorString = QString("Cannot map shared memory ") + name;
+            return false;
+        }
+
+        image = cv::Mat(height, width, type, static_cast<uchar*>(address) + offset, step);
+        return true;
+#else
+        *errorString = QString("Shared memory transport needs a POSIX system");
+        return false;
+#endif
+    }
+
+    cv::Mat image;
+
+private:
+    void *address;
+    size_t length;
+};
+
+// --- Map, adjust, unmap; the reply goes back to the daemon's thread ---
+class DaemonJob : public QRunnable
+{
+public:
+    DaemonJob(QObject *jobOwner, int batch, int index, const QJsonObject& request)
+        : owner(jobOwner), batchKey(batch), slot(index), object(request) {}
+
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        QJsonObject reply;
+        if (object.contains("id"))
+        {
+            reply["id"] = object["id"];
+        }
+
+        // --- A cv::Exception must not escape the pool and end the daemon ---
+        QString error;
+        bool succeeded = false;
+        try
+        {
+            succeeded = process(&error);
+        }
+        catch (const cv::Exception& exception)
+        {
+            error = QString::fromStdString(exception.what());
+        }
+
+        reply["ok"] = succeeded;
+        if (!succeeded)
+        {
+            reply["error"] = error;
+        }
+        reply["milliseconds"] = timer.nsecsElapsed() / 1.0e6;
+
+        QMetaObject::invokeMethod(owner, "jobFinished", Qt::QueuedConnection,
+                                  Q_ARG(int, batchKey),
+                                  Q_ARG(int, slot),
+                                  Q_ARG(QJsonObject, reply));
+    }
+
+private:
+    QObject *owner;
+    int batchKey;
+    int slot;
+    QJsonObject object;
+
+    bool process(QString *error)
+    {
+        AdjustmentRequest request;
+        if (!request.fromJson(object["adjust"].toObject(), error))
+        {
+            return false;
+        }
+
+        SharedImage input;
+        if (!input.attach(object["input"].toObject(), error))
+        {
+            return false;
+        }
+
+        // --- Without an output segment the input is adjusted in place ---
+        SharedImage output;
+        if (!object.contains("output"))
+        {
+            output.image = input.image;
+        }
+        else if (!output.attach(object["output"].toObject(), error))
+        {
+            return false;
+        }
+
+        if (output.image.size() != input.image.size() || output.image.type() != input.image.type())
+        {
+            *error = QString("Output image must match the input");
+            return false;
+        }
+
+        // --- The output header has the right shape, so nothing is reallocated ---
+        if (!request.apply(input.image, output.image))
+        {
+            *error = QString("Images must be 8-bit BGR");
+            return false;
+        }
+        return true;
+    }
+};
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+ProcessingDaemon::ProcessingDaemon(int workers, QObject *parent) :
+    QObject(parent)
+{
+    pool.setMaxThreadCount(std::max(1, workers));
+    nextBatchKey = 0;
+
+    connect(&server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+ProcessingDaemon::~ProcessingDaemon()
+{
+    pool.waitForDone();
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool ProcessingDaemon::start(QString socketName)
+{
+    // --- Only the user running the daemon may connect ---
+    QLocalServer::removeServer(socketName);
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (!server.listen(socketName))
+    {
+        std::cout << "Daemon: " << server.errorString().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+QString ProcessingDaemon::serverPath() const
+{
+    return server.fullServerName();
+}
+
+// ----- Connections ----------------------------------------------------------
+void ProcessingDaemon::acceptConnection()
+{
+    while (server.hasPendingConnections())
+    {
+        QLocalSocket *socket = server.nextPendingConnection();
+        buffers.insert(socket, QByteArray());
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+    }
+}
+
+void ProcessingDaemon::readRequests()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket)
+    {
+        return;
+    }
+
+    QByteArray& buffer = buffers[socket];
+    buffer.append(socket->readAll());
+
+    // --- Every complete line is dispatched, pipelined lines run concurrently ---
+    int end;
+    while ((end = buffer.indexOf('\n')) >= 0)
+    {
+        QByteArray line = buffer.left(end).trimmed();
+        buffer.remove(0, end + 1);
+
+        if (!line.isEmpty())
+        {
+            dispatch(socket, line);
+        }
+    }
+
+    if (buffer.size() > maximumLineBytes)
+    {
+        QJsonObject error;
+        error["ok"] = false;
+        error["error"] = QString("Request line too long");
+        reply(socket, error);
+        socket->disconnectFromServer();
+    }
+}
+
+void ProcessingDaemon::dropConnection()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket)
+    {
+        return;
+    }
+
+    buffers.remove(socket);
+    socket->deleteLater();
+}
+
+// ----- Requests -------------------------------------------------------------
+void ProcessingDaemon::dispatch(QLocalSocket *socket, const QByteArray& line)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+
+    if (!document.isObject())
+    {
+        QJsonObject error;
+        error["ok"] = false;
+        error["error"] = parseError.errorString();
+        reply(socket, error);
+        return;
+    }
+
+    QJsonObject object = document.object();
+    QJsonArray requests;
+
+    PendingBatch batch;
+    batch.socket = socket;
+    batch.isBatch = object.contains("batch");
+    if (batch.isBatch)
+    {
+        requests = object["batch"].toArray();
+    }
+    else
+    {
+        requests.append(object);
+    }
+
+    if (requests.isEmpty())
+    {
+        QJsonObject empty;
+        empty["batch"] = QJsonArray();
+        reply(socket, empty);
+        return;
+    }
+
+    batch.remaining = requests.size();
+    for (int index=0; index < requests.size(); index++)
+    {
+        batch.replies.append(QJsonValue());
+    }
+
+    int batchKey = nextBatchKey++;
+    batches.insert(batchKey, batch);
+
+    for (int index=0; index < requests.size(); index++)
+    {
+        pool.start(new DaemonJob(this, batchKey, index, requests.at(index).toObject()));
+    }
+}
+
+void ProcessingDaemon::jobFinished(int batchKey, int slot, QJsonObject result)
+{
+    if (!batches.contains(batchKey))
+    {
+        return;
+    }
+
+    PendingBatch& batch = batches[batchKey];
+    batch.replies[slot] = result;
+    if (--batch.remaining > 0)
+    {
+        return;
+    }
+
+    // --- A batch is answered once, in request order ---
+    if (batch.socket)
+    {
+        if (batch.isBatch)
+        {
+            QJsonObject object;
+            object["batch"] = batch.replies;
+            reply(batch.socket, object);
+        }
+        else
+        {
+            reply(batch.socket, batch.replies.at(0).toObject());
+        }
+    }
+    batches.remove(batchKey);
+}
+
+void ProcessingDaemon::reply(QLocalSocket *socket, const QJsonObject& object)
+{
+    socket->write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
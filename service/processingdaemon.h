@@ -0,0 +1,65 @@
+#ifndef PROCESSINGDAEMON_H
+#define PROCESSINGDAEMON_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThreadPool>
+
+// --- Local daemon: adjustments over a Unix socket, pixels in shared memory ---
+// Each line on the socket is one JSON request, or {"batch": [...]} for several
+// run side by side on the worker pool and answered together. A request names
+// POSIX shared memory segments for its input and (optionally) output image:
+//
+//   {"id": 7, "input": {"shm": "/frame", "width": 1920, "height": 1080},
+//    "output": {"shm": "/result", ...}, "adjust": {"red": 1.1, ...}}
+//
+// The segments are mapped and wrapped in cv::Mat headers, so pixels are never
+// copied or serialized; without "output" the input is adjusted in place. The
+// "adjust" object is an AdjustmentRequest.
+class ProcessingDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    // --- Constructor / Destructor ---
+    ProcessingDaemon(int workers, QObject *parent = 0);
+    ~ProcessingDaemon();
+
+    // --- Accessors ---
+    bool start(QString socketName);
+    QString serverPath() const;
+
+private slots:
+    void acceptConnection();
+    void readRequests();
+    void dropConnection();
+    void jobFinished(int batchKey, int slot, QJsonObject result);
+
+private:
+    // --- Replies still being computed for one line of input ---
+    struct PendingBatch
+    {
+        QPointer<QLocalSocket> socket;
+        QJsonArray replies;
+        int remaining;
+        bool isBatch;
+    };
+
+    QLocalServer server;
+    QThreadPool pool;
+    QHash<QLocalSocket*, QByteArray> buffers;
+    QHash<int, PendingBatch> batches;
+    int nextBatchKey;
+
+    void dispatch(QLocalSocket *socket, const QByteArray& line);
+    void reply(QLocalSocket *socket, const QJsonObject& object);
+};
+
+#endif // PROCESSINGDAEMON_H
@@ -0,0 +1,19 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/adjustmentrequest.cpp \
+    $$PWD/httpserver.cpp \
+    $$PWD/processingdaemon.cpp \
+    $$PWD/servicemain.cpp \
+    $$PWD/watchfolder.cpp \
+
+HEADERS += \
+    $$PWD/adjustmentrequest.h \
+    $$PWD/httpserver.h \
+    $$PWD/processingdaemon.h \
+    $$PWD/servicemain.h \
+    $$PWD/watchfolder.h \
+
+# --- shm_open lives in librt on older glibc ---
+unix:!macx: LIBS += -lrt
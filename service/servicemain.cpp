@@ -0,0 +1,203 @@
+#include "servicemain.h"
+
+#include <iostream>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QPair>
+#include <QString>
+#include <QThread>
+
+#include "adjustmentpreset.h"
+#include "batchpipeline.h"
+#include "httpserver.h"
+#include "framesequence.h"
+#include "processingdaemon.h"
+#include "sequencepipeline.h"
+#include "watchfolder.h"
+
+// ----- Mode Selection -------------------------------------------------------
+bool isServiceMode(int argc, char *argv[])
+{
+    for (int index=1; index < argc; index++)
+    {
+        QString argument(argv[index]);
+        if (argument == "--watch" || argument == "--batch" || argument == "--sequence"
+                || argument == "--daemon" || argument == "--http")
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----- Headless Main --------------------------------------------------------
+int runService(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Imaging Colors headless processing");
+    parser.addHelpOption();
+
+    QCommandLineOption watchOption("watch", "Watch <folder> for new images.", "folder");
+    QCommandLineOption batchOption("batch", "Process every image in <folder> once, then exit.", "folder");
+    QCommandLineOption sequenceOption("sequence", "Stream a video, numbered pattern or folder of frames.", "source");
+    QCommandLineOption daemonOption("daemon", "Serve adjustments on local socket <name>.", "name");
+    QCommandLineOption httpOption("http", "Serve adjustments over HTTP on 127.0.0.1:<port>.", "port");
+    QCommandLineOption outputOption("output", "Write results to <folder>, or a video or pattern for --sequence.", "folder");
+    QCommandLineOption presetOption("preset", "Adjustment preset (.json or .cube) to apply.", "file");
+    QCommandLineOption workersOption("workers", "Number of worker threads.", "count",
+                                     QString::number(QThread::idealThreadCount()));
+
+    BatchPipeline::Settings defaults;
+    QCommandLineOption decodeOption("decode-threads", "Batch decode threads.", "count",
+                                    QString::number(defaults.decodeThreads));
+    QCommandLineOption processOption("process-threads", "Batch adjustment threads.", "count",
+                                     QString::number(defaults.processThreads));
+    QCommandLineOption encodeOption("encode-threads", "Batch PNG encode threads.", "count",
+                                    QString::number(defaults.encodeThreads));
+    QCommandLineOption depthOption("queue-depth", "Images buffered between batch stages.", "count",
+                                   QString::number(defaults.queueDepth));
+    QCommandLineOption temporalOption("temporal-tiles", "Reuse unchanged --sequence tiles of <size> px, 0 for off.",
+                                      "size", QString::number(TemporalTileCache::defaultTileSize));
+    QCommandLineOption fourccOption("fourcc", "Codec of a --sequence video output.", "code", "MJPG");
+
+    parser.addOption(watchOption);
+    parser.addOption(batchOption);
+    parser.addOption(sequenceOption);
+    parser.addOption(daemonOption);
+    parser.addOption(httpOption);
+    parser.addOption(outputOption);
+    parser.addOption(presetOption);
+    parser.addOption(workersOption);
+    parser.addOption(decodeOption);
+    parser.addOption(processOption);
+    parser.addOption(encodeOption);
+    parser.addOption(depthOption);
+    parser.addOption(fourccOption);
+    parser.addOption(temporalOption);
+    parser.process(app);
+
+    // --- The daemon takes its adjustments from each request ---
+    if (parser.isSet(daemonOption))
+    {
+        ProcessingDaemon daemon(parser.value(workersOption).toInt());
+        if (!daemon.start(parser.value(daemonOption)))
+        {
+            return 1;
+        }
+
+        std::cout << "Listening on " << daemon.serverPath().toStdString() << std::endl;
+        return app.exec();
+    }
+
+    if (parser.isSet(httpOption))
+    {
+        HttpServer server(parser.value(workersOption).toInt());
+        if (!server.start(static_cast<quint16>(parser.value(httpOption).toUInt())))
+        {
+            return 1;
+        }
+
+        std::cout << "Listening on http://127.0.0.1:" << server.port() << "/" << std::endl;
+        return app.exec();
+    }
+
+    if (!parser.isSet(outputOption) || !parser.isSet(presetOption))
+    {
+        std::cout << "Both --output and --preset are required." << std::endl;
+        return 1;
+    }
+
+    // --- Compile once, every image then runs the same fused kernel ---
+    QString error;
+    AdjustmentPreset preset = AdjustmentPreset::load(parser.value(presetOption), &error);
+    if (!error.isEmpty())
+    {
+        std::cout << error.toStdString() << std::endl;
+        return 1;
+    }
+
+    CompiledPreset compiled = preset.compile();
+    std::cout << "Preset compiled to " << compiled.kernelName().toStdString() << std::endl;
+
+    if (parser.isSet(batchOption))
+    {
+        QDir inputDirectory(parser.value(batchOption));
+        QDir outputDirectory(parser.value(outputOption));
+        if (!inputDirectory.exists() || !outputDirectory.mkpath("."))
+        {
+            std::cout << "Batch: missing input or output folder" << std::endl;
+            return 1;
+        }
+
+        QList< QPair<QString, QString> > jobs;
+        QFileInfoList entries = inputDirectory.entryInfoList(QDir::Files, QDir::Name);
+        for (int index=0; index < entries.size(); index++)
+        {
+            if (WatchFolder::isImageFile(entries.at(index).filePath()))
+            {
+                jobs.append(qMakePair(entries.at(index).absoluteFilePath(),
+                                      outputDirectory.absoluteFilePath(
+                                          entries.at(index).completeBaseName() + ".png")));
+            }
+        }
+
+        BatchPipeline::Settings settings;
+        settings.decodeThreads = parser.value(decodeOption).toInt();
+        settings.processThreads = parser.value(processOption).toInt();
+        settings.encodeThreads = parser.value(encodeOption).toInt();
+        settings.queueDepth = parser.value(depthOption).toInt();
+
+        BatchPipeline pipeline(compiled, settings);
+        BatchPipeline::Statistics statistics = pipeline.run(jobs);
+
+        std::cout << pipeline.report().toStdString() << std::endl;
+        return statistics.failed > 0 ? 1 : 0;
+    }
+
+    // --- Stage threads keep the sequence defaults unless given explicitly ---
+    if (parser.isSet(sequenceOption))
+    {
+        FrameSequence sequence;
+        if (!sequence.open(parser.value(sequenceOption), &error))
+        {
+            std::cout << error.toStdString() << std::endl;
+            return 1;
+        }
+
+        SequencePipeline::Settings settings;
+        if (parser.isSet(decodeOption)) settings.readThreads = parser.value(decodeOption).toInt();
+        if (parser.isSet(processOption)) settings.processThreads = parser.value(processOption).toInt();
+        if (parser.isSet(encodeOption)) settings.encodeThreads = parser.value(encodeOption).toInt();
+        if (parser.isSet(depthOption)) settings.readAhead = parser.value(depthOption).toInt();
+        settings.fourcc = parser.value(fourccOption);
+        settings.temporalTileSize = parser.value(temporalOption).toInt();
+
+        SequencePipeline pipeline(compiled, settings);
+        bool written = pipeline.run(sequence, parser.value(outputOption), &error);
+        if (!written)
+        {
+            std::cout << error.toStdString() << std::endl;
+        }
+
+        std::cout << pipeline.report().toStdString() << std::endl;
+        return written && pipeline.statistics().failed == 0 ? 0 : 1;
+    }
+
+    WatchFolder watchFolder(parser.value(watchOption),
+                            parser.value(outputOption),
+                            compiled,
+                            parser.value(workersOption).toInt());
+    if (!watchFolder.start())
+    {
+        return 1;
+    }
+
+    std::cout << "Watching " << parser.value(watchOption).toStdString() << std::endl;
+    return app.exec();
+}
@@ -0,0 +1,8 @@
+#ifndef SERVICEMAIN_H
+#define SERVICEMAIN_H
+
+// --- Headless entry points, selected from the command line in main() ---
+bool isServiceMode(int argc, char *argv[]);
+int runService(int argc, char *argv[]);
+
+#endif // SERVICEMAIN_H
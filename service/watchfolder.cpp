@@ -0,0 +1,291 @@
+#include "watchfolder.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMetaObject>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int settleMilliseconds = 500;
+
+}
+
+// ----- Constructor / Destructor ---------------------------------------------
+WatchFolder::WatchFolder(QString inputPath,
+                         QString outputPath,
+                         const CompiledPreset& preset,
+                         int workers,
+                         QObject *parent) :
+    QObject(parent),
+    inputDirectory(inputPath),
+    outputDirectory(outputPath),
+    compiled(preset)
+{
+    // --- PNG encoding is the slow stage, so it gets the workers ---
+    BatchPipeline::Settings settings;
+    settings.encodeThreads = std::max(1, workers);
+
+    pipeline = new BatchPipeline(preset, settings);
+    pipeline->setFinishedCallback([this](const BatchJob& job)
+    {
+        QMetaObject::invokeMethod(this, "jobFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, job.inputPath),
+                                  Q_ARG(bool, job.succeeded));
+    });
+    pipeline->start();
+
+    // --- Two images per worker keeps every worker busy, bounds memory ---
+    maxInFlight = 2 * settings.encodeThreads;
+    inFlight = 0;
+    processedTotal = 0;
+    failedTotal = 0;
+
+    inotifyDescriptor = -1;
+    notifier = 0;
+    watcher = 0;
+
+    scanTimer.setSingleShot(true);
+    scanTimer.setInterval(settleMilliseconds);
+    connect(&scanTimer, SIGNAL(timeout()), this, SLOT(scanDirectory()));
+}
+
+WatchFolder::~WatchFolder()
+{
+    pipeline->finish();
+    delete pipeline;
+
+#ifdef Q_OS_LINUX
+    if (inotifyDescriptor >= 0)
+    {
+        ::close(inotifyDescriptor);
+    }
+#endif
+}
+
+// ----- Accessors ------------------------------------------------------------
+bool WatchFolder::start()
+{
+    if (!inputDirectory.exists() || !outputDirectory.mkpath("."))
+    {
+        std::cout << "Watch folder: missing input or output folder" << std::endl;
+        return false;
+    }
+
+    // --- Outputs dropped back into the input would be picked up again, forever ---
+    if (inputDirectory.canonicalPath() == outputDirectory.canonicalPath())
+    {
+        std::cout << "Watch folder: output folder must differ from the input folder" << std::endl;
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyDescriptor >= 0
+            && inotify_add_watch(inotifyDescriptor,
+                                 QFile::encodeName(inputDirectory.absolutePath()).constData(),
+                                 IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) >= 0)
+    {
+        notifier = new QSocketNotifier(inotifyDescriptor, QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+    }
+#endif
+
+    // --- Portable fallback, rescans the folder once it has settled ---
+    if (!notifier)
+    {
+        watcher = new QFileSystemWatcher(QStringList(inputDirectory.absolutePath()), this);
+        connect(watcher, SIGNAL(directoryChanged(QString)), &scanTimer, SLOT(start()));
+    }
+
+    // --- Pick up whatever was dropped while the service was down ---
+    scanDirectory();
+    return true;
+}
+
+int WatchFolder::processedCount() const
+{
+    return processedTotal;
+}
+
+int WatchFolder::failedCount() const
+{
+    return failedTotal;
+}
+
+bool WatchFolder::isImageFile(QString filePath)
+{
+    static const QStringList suffixes = QStringList()
+            << "bmp" << "ict" << "jpeg" << "jpg" << "png" << "tif" << "tiff";
+
+    return suffixes.contains(QFileInfo(filePath).suffix().toLower());
+}
+
+// --- Modification time and size, empty once the file is gone ---
+QString WatchFolder::signature(QString filePath)
+{
+    QFileInfo info(filePath);
+    if (!info.exists())
+    {
+        return QString();
+    }
+    return QString::number(info.lastModified().toMSecsSinceEpoch())
+            + QString(":") + QString::number(info.size());
+}
+
+// ----- Change Notification --------------------------------------------------
+void WatchFolder::readEvents()
+{
+#ifdef Q_OS_LINUX
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        ssize_t length = ::read(inotifyDescriptor, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (char *cursor = buffer; cursor < buffer + length; )
+        {
+            const struct inotify_event *event =
+                    reinterpret_cast<const struct inotify_event*>(cursor);
+
+            if (event->len > 0 && !(event->mask & IN_ISDIR))
+            {
+                QString filePath = inputDirectory.absoluteFilePath(QFile::decodeName(event->name));
+                if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    forget(filePath);
+                }
+                else
+                {
+                    enqueue(filePath, true);
+                }
+            }
+            cursor += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+void WatchFolder::scanDirectory()
+{
+    QFileInfoList entries = inputDirectory.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+
+    QSet<QString> present;
+    for (int index=0; index < entries.size(); index++)
+    {
+        present.insert(entries.at(index).absoluteFilePath());
+        enqueue(entries.at(index).absoluteFilePath(), false);
+    }
+
+    // --- Forget files that left the folder, so a long-running watch stays small ---
+    QHash<QString, QString>::iterator entry = written.begin();
+    while (entry != written.end())
+    {
+        entry = present.contains(entry.key()) ? entry + 1 : written.erase(entry);
+    }
+}
+
+// ----- Work Queue -----------------------------------------------------------
+// --- rewritten: the notifier saw a write, so even an equal signature is new ---
+void WatchFolder::enqueue(QString filePath, bool rewritten)
+{
+    QString current = signature(filePath);
+    if (!isImageFile(filePath) || current.isEmpty())
+    {
+        return;
+    }
+
+    // --- One job per path at a time; a newer version runs after it ---
+    if (queued.contains(filePath))
+    {
+        if (rewritten || queued.value(filePath) != current)
+        {
+            changed.insert(filePath);
+        }
+        return;
+    }
+    if (!rewritten && written.value(filePath) == current)
+    {
+        return;
+    }
+
+    queued.insert(filePath, current);
+    pending.append(filePath);
+    dispatch();
+}
+
+// --- The file left the folder: drop what is known about it ---
+void WatchFolder::forget(QString filePath)
+{
+    written.remove(filePath);
+    changed.remove(filePath);
+    if (pending.removeAll(filePath) > 0)
+    {
+        queued.remove(filePath);
+    }
+}
+
+void WatchFolder::dispatch()
+{
+    while (inFlight < maxInFlight && !pending.isEmpty())
+    {
+        QString inputPath = pending.first();
+        QString outputPath = outputDirectory.absoluteFilePath(
+                    QFileInfo(inputPath).fileName() + ".png");
+
+        // --- Never block the event loop; jobFinished() dispatches again ---
+        if (!pipeline->trySubmit(inputPath, outputPath))
+        {
+            break;
+        }
+
+        pending.removeFirst();
+        inFlight++;
+    }
+}
+
+void WatchFolder::jobFinished(QString filePath, bool succeeded)
+{
+    inFlight--;
+
+    if (succeeded)
+    {
+        processedTotal++;
+    }
+    else
+    {
+        failedTotal++;
+    }
+
+    std::cout << (succeeded ? "Processed " : "Failed ")
+              << filePath.toStdString() << std::endl;
+    emit processed(filePath, succeeded);
+
+    // --- Failures are remembered too, a rescan does not retry them forever ---
+    QString current = queued.take(filePath);
+    if (signature(filePath).isEmpty())
+    {
+        forget(filePath);
+    }
+    else
+    {
+        written.insert(filePath, current);
+    }
+    if (changed.remove(filePath))
+    {
+        enqueue(filePath, true);
+    }
+
+    dispatch();
+}
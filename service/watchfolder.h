@@ -0,0 +1,85 @@
+#ifndef WATCHFOLDER_H
+#define WATCHFOLDER_H
+
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "adjustmentpreset.h"
+#include "batchpipeline.h"
+
+// --- Hot folder: new images are adjusted and written to an output folder ---
+// New files are reported by inotify on Linux (IN_CLOSE_WRITE / IN_MOVED_TO,
+// so half-written scans are never picked up; IN_DELETE / IN_MOVED_FROM drop
+// them again) and by QFileSystemWatcher plus a settling delay elsewhere.
+// Images run through a long-lived BatchPipeline; at most maxInFlight are
+// inside it at once, the rest wait in pending.
+// Outputs keep the source file name, so scan.jpg and scan.tif become
+// scan.jpg.png and scan.tif.png. A file is known by its path, modification
+// time and size: a re-dropped scan is processed again, an unchanged one is
+// skipped on rescans, and entries go once the file leaves the folder.
+class WatchFolder : public QObject
+{
+    Q_OBJECT
+
+public:
+    // --- Constructor / Destructor ---
+    WatchFolder(QString inputPath,
+                QString outputPath,
+                const CompiledPreset& preset,
+                int workers,
+                QObject *parent = 0);
+    ~WatchFolder();
+
+    // --- Accessors ---
+    bool start();
+    int processedCount() const;
+    int failedCount() const;
+
+    static bool isImageFile(QString filePath);
+
+signals:
+    void processed(QString filePath, bool succeeded);
+
+private slots:
+    void readEvents();
+    void scanDirectory();
+    void jobFinished(QString filePath, bool succeeded);
+
+private:
+    // --- Folders and preset ---
+    QDir inputDirectory;
+    QDir outputDirectory;
+    CompiledPreset compiled;
+
+    // --- Bounded work queue ---
+    BatchPipeline *pipeline;
+    int maxInFlight;
+    int inFlight;
+    QStringList pending;
+    QHash<QString, QString> queued;     // path to signature, pending or in the pipeline
+    QHash<QString, QString> written;    // path to signature of the last output
+    QSet<QString> changed;              // rewritten while still queued
+
+    int processedTotal;
+    int failedTotal;
+
+    // --- Change notification ---
+    int inotifyDescriptor;
+    QSocketNotifier *notifier;
+    QFileSystemWatcher *watcher;
+    QTimer scanTimer;
+
+    static QString signature(QString filePath);
+    void enqueue(QString filePath, bool rewritten);
+    void forget(QString filePath);
+    void dispatch();
+};
+
+#endif // WATCHFOLDER_H
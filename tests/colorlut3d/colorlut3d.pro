@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_colorlut3d
+
+SOURCES += tst_colorlut3d.cpp
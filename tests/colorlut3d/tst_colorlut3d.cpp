@@ -0,0 +1,276 @@
+#include <QtTest>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cstdlib>
+#include <math.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "colorlut3d.h"
+
+// --- Tetrahedral interpolation against an independent reference. ---
+// The reference walks from the lower corner of the cell along the axes in
+// order of decreasing fraction, which is the definition the tables in
+// colorlut3d.cpp unroll into six branches. The .cube reader is checked
+// against keywords it does not know and rows that are not numbers.
+class TestColorLUT3D : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void identityIsExact();
+    void matchesReferenceTetrahedra();
+    void reproducesAffineTables();
+    void applyMatchesLookup();
+    void loadCube_data();
+    void loadCube();
+
+private:
+    QTemporaryDir directory;
+
+    static ColorLUT3D randomTable(int points, quint64 seed);
+    static void reference(const ColorLUT3D& lut, const float rgb[3], float result[3]);
+};
+
+// ----- Helpers --------------------------------------------------------------
+ColorLUT3D TestColorLUT3D::randomTable(int points, quint64 seed)
+{
+    ColorLUT3D result(points);
+    cv::RNG random(seed);
+
+    for (int b=0; b < points; b++)
+    {
+        for (int g=0; g < points; g++)
+        {
+            for (int r=0; r < points; r++)
+            {
+                float *rgb = result.node(r, g, b);
+                rgb[0] = random.uniform(0.0f, 1.0f);
+                rgb[1] = random.uniform(0.0f, 1.0f);
+                rgb[2] = random.uniform(0.0f, 1.0f);
+            }
+        }
+    }
+    return result;
+}
+
+void TestColorLUT3D::reference(const ColorLUT3D& lut, const float rgb[3], float result[3])
+{
+    int lower[3];
+    double fraction[3];
+    int order[3] = { 0, 1, 2 };
+
+    for (int axis=0; axis < 3; axis++)
+    {
+        double x = std::max(0.0, std::min(1.0, static_cast<double>(rgb[axis]))) * (lut.size - 1);
+        lower[axis] = std::min(static_cast<int>(x), lut.size - 2);
+        fraction[axis] = x - lower[axis];
+    }
+    for (int pass=0; pass < 2; pass++)
+    {
+        for (int index=0; index < 2; index++)
+        {
+            if (fraction[order[index]] < fraction[order[index + 1]])
+            {
+                std::swap(order[index], order[index + 1]);
+            }
+        }
+    }
+
+    // --- Four corners, one axis step at a time, weighted by fraction differences ---
+    int corner[3] = { lower[0], lower[1], lower[2] };
+    double weight[4] = { 1.0 - fraction[order[0]],
+                         fraction[order[0]] - fraction[order[1]],
+                         fraction[order[1]] - fraction[order[2]],
+                         fraction[order[2]] };
+
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    for (int step=0; step < 4; step++)
+    {
+        if (step > 0)
+        {
+            corner[order[step - 1]]++;
+        }
+        const float *node = lut.node(corner[0], corner[1], corner[2]);
+        for (int channel=0; channel < 3; channel++)
+        {
+            sum[channel] += weight[step] * node[channel];
+        }
+    }
+    for (int channel=0; channel < 3; channel++)
+    {
+        result[channel] = static_cast<float>(sum[channel]);
+    }
+}
+
+// ----- Tests ----------------------------------------------------------------
+// --- Every 8-bit value sits on a linear function, so identity maps exactly ---
+void TestColorLUT3D::identityIsExact()
+{
+    cv::Mat input(256, 256, CV_8UC3);
+    for (int y=0; y < input.rows; y++)
+    {
+        for (int x=0; x < input.cols; x++)
+        {
+            input.at<cv::Vec3b>(y, x) = cv::Vec3b(x, y, (7 * x + 13 * y) & 255);
+        }
+    }
+
+    cv::Mat output;
+    ColorLUT3D::identity(33).apply(input, output);
+    QVERIFY(cv::norm(input, output, cv::NORM_INF) == 0.0);
+}
+
+// --- All six orderings of the fractions, ties included ---
+void TestColorLUT3D::matchesReferenceTetrahedra()
+{
+    const ColorLUT3D lut = randomTable(2, 29);
+    const float steps[] = { 0.0f, 0.1f, 0.25f, 0.5f, 0.75f, 0.9f, 1.0f };
+    const int count = sizeof(steps) / sizeof(steps[0]);
+
+    for (int r=0; r < count; r++)
+    {
+        for (int g=0; g < count; g++)
+        {
+            for (int b=0; b < count; b++)
+            {
+                float rgb[3] = { steps[r], steps[g], steps[b] };
+                float expected[3];
+                reference(lut, rgb, expected);
+
+                lut.lookup(rgb);
+                for (int channel=0; channel < 3; channel++)
+                {
+                    QVERIFY2(fabs(rgb[channel] - expected[channel]) < 1e-5,
+                             qPrintable(QString("at %1 %2 %3").arg(steps[r]).arg(steps[g]).arg(steps[b])));
+                }
+            }
+        }
+    }
+}
+
+// --- Tetrahedral interpolation is exact for affine tables, inside any cell ---
+void TestColorLUT3D::reproducesAffineTables()
+{
+    const int points = 17;
+    ColorLUT3D lut(points);
+    for (int b=0; b < points; b++)
+    {
+        for (int g=0; g < points; g++)
+        {
+            for (int r=0; r < points; r++)
+            {
+                float red = r / float(points - 1);
+                float green = g / float(points - 1);
+                float blue = b / float(points - 1);
+
+                float *rgb = lut.node(r, g, b);
+                rgb[0] = 0.5f * green + 0.25f * blue + 0.1f;
+                rgb[1] = 0.8f * red - 0.2f * blue + 0.2f;
+                rgb[2] = 0.3f * red + 0.3f * green + 0.3f * blue;
+            }
+        }
+    }
+
+    cv::RNG random(31);
+    for (int sample=0; sample < 10000; sample++)
+    {
+        float red = random.uniform(0.0f, 1.0f);
+        float green = random.uniform(0.0f, 1.0f);
+        float blue = random.uniform(0.0f, 1.0f);
+
+        float rgb[3] = { red, green, blue };
+        lut.lookup(rgb);
+        QVERIFY(fabs(rgb[0] - (0.5f * green + 0.25f * blue + 0.1f)) < 1e-5);
+        QVERIFY(fabs(rgb[1] - (0.8f * red - 0.2f * blue + 0.2f)) < 1e-5);
+        QVERIFY(fabs(rgb[2] - (0.3f * red + 0.3f * green + 0.3f * blue)) < 1e-5);
+    }
+}
+
+// --- The vectorized image path agrees with the scalar lookup to one code ---
+void TestColorLUT3D::applyMatchesLookup()
+{
+    const ColorLUT3D lut = randomTable(17, 37);
+
+    cv::Mat input(64, 64, CV_8UC3);
+    cv::randu(input, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    cv::Mat output;
+    lut.apply(input, output);
+
+    for (int y=0; y < input.rows; y++)
+    {
+        for (int x=0; x < input.cols; x++)
+        {
+            const cv::Vec3b& bgr = input.at<cv::Vec3b>(y, x);
+            float rgb[3] = { bgr[2] / 255.0f, bgr[1] / 255.0f, bgr[0] / 255.0f };
+            lut.lookup(rgb);
+
+            const cv::Vec3b& mapped = output.at<cv::Vec3b>(y, x);
+            for (int channel=0; channel < 3; channel++)
+            {
+                int expected = cv::saturate_cast<uchar>(255.0f * rgb[channel]);
+                QVERIFY(std::abs(mapped[2 - channel] - expected) <= 1);
+            }
+        }
+    }
+}
+
+// ----- .cube Files -----------------------------------------------------------
+// --- A 2-point table; the header varies, the eight rows stay the same ---
+void TestColorLUT3D::loadCube_data()
+{
+    QTest::addColumn<QString>("header");
+    QTest::addColumn<QString>("rows");
+    QTest::addColumn<bool>("valid");
+
+    const QString table = "0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1 1\n";
+
+    QTest::newRow("plain") << "LUT_3D_SIZE 2\n" << table << true;
+    QTest::newRow("title and domain") << "TITLE \"Test\"\nDOMAIN_MIN 0 0 0\nDOMAIN_MAX 1 1 1\nLUT_3D_SIZE 2\n"
+                                      << table << true;
+    QTest::newRow("input range") << "LUT_3D_SIZE 2\nLUT_3D_INPUT_RANGE 0 1\n" << table << true;
+    QTest::newRow("unknown keyword") << "# comment\nLUT_IN_VIDEO_RANGE\nLUT_3D_SIZE 2\n" << table << true;
+    QTest::newRow("signed and exponent") << "LUT_3D_SIZE 2\n"
+                                         << "-0 0.0 0\n1e0 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1 1.0\n"
+                                         << true;
+    QTest::newRow("data before size") << "" << table << false;
+    QTest::newRow("bad number") << "LUT_3D_SIZE 2\n" << "0 0 x\n" + table.mid(6) << false;
+    QTest::newRow("two fields") << "LUT_3D_SIZE 2\n" << "0 0\n" + table.mid(6) << false;
+    QTest::newRow("too few rows") << "LUT_3D_SIZE 2\n" << table.left(36) << false;
+    QTest::newRow("bad domain") << "DOMAIN_MIN 0 zero 0\nLUT_3D_SIZE 2\n" << table << false;
+    QTest::newRow("1D table") << "LUT_1D_SIZE 2\n" << table << false;
+}
+
+void TestColorLUT3D::loadCube()
+{
+    QFETCH(QString, header);
+    QFETCH(QString, rows);
+    QFETCH(bool, valid);
+
+    QVERIFY(directory.isValid());
+    QString path = directory.filePath(QString("%1.cube").arg(QTest::currentDataTag()));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write((header + rows).toLatin1());
+    file.close();
+
+    QString error;
+    ColorLUT3D lut = ColorLUT3D::loadCube(path, &error);
+    QCOMPARE(lut.isValid(), valid);
+    QCOMPARE(error.isEmpty(), valid);
+
+    if (valid)
+    {
+        float rgb[3] = { 0.25f, 0.5f, 0.75f };
+        lut.lookup(rgb);
+        QVERIFY(fabs(rgb[0] - 0.25f) < 1e-6 && fabs(rgb[1] - 0.5f) < 1e-6 && fabs(rgb[2] - 0.75f) < 1e-6);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestColorLUT3D)
+
+#include "tst_colorlut3d.moc"
@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_colortables
+
+SOURCES += tst_colortables.cpp
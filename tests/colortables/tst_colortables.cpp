@@ -0,0 +1,166 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <math.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "colortables.h"
+#include "myimage.h"
+
+// --- Table accuracy and the HSI conversion built on it. ---
+// Each table is compared with the C library over its whole domain; hue is
+// compared with the angle of the chroma vector, which is what the acos form
+// in MyImage::rgbToHSI computes.
+class TestColorTables : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cosineAccuracy();
+    void srgbAccuracy();
+    void srgbRoundTrip();
+    void hsiPrimaries();
+    void hsiHueAccuracy_data();
+    void hsiHueAccuracy();
+    void hsiRoundTrip();
+
+private:
+    static double decodeSRGB(double x);
+    static double encodeSRGB(double x);
+    static double chromaHue(double R, double G, double B);
+};
+
+// ----- Helpers --------------------------------------------------------------
+double TestColorTables::decodeSRGB(double x)
+{
+    return x <= 0.04045 ? x / 12.92 : pow((x + 0.055) / 1.055, 2.4);
+}
+
+double TestColorTables::encodeSRGB(double x)
+{
+    return x <= 0.0031308 ? x * 12.92 : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+}
+
+// --- Hue as the angle of the chroma vector, 0..1 ---
+double TestColorTables::chromaHue(double R, double G, double B)
+{
+    double alpha = R - 0.5 * (G + B);
+    double beta = 0.5 * sqrt(3.0) * (G - B);
+    double hue = atan2(beta, alpha) / (2.0 * ColorTables::PI);
+    return hue < 0.0 ? hue + 1.0 : hue;
+}
+
+// ----- Tables ---------------------------------------------------------------
+void TestColorTables::cosineAccuracy()
+{
+    double worst = 0.0;
+    for (double x=-10.0; x < 10.0; x += 1e-4)
+    {
+        worst = std::max(worst, fabs(ColorTables::cosine(x) - cos(x)));
+    }
+    QVERIFY2(worst < 1e-6, qPrintable(QString("cosine error %1").arg(worst)));
+}
+
+void TestColorTables::srgbAccuracy()
+{
+    double decodeWorst = 0.0;
+    double encodeWorst = 0.0;
+    for (double x=0.0; x <= 1.0; x += 1e-5)
+    {
+        decodeWorst = std::max(decodeWorst, fabs(ColorTables::srgbToLinearFloat(x) - decodeSRGB(x)));
+        encodeWorst = std::max(encodeWorst, fabs(ColorTables::linearToSRGBFloat(x) - encodeSRGB(x)));
+    }
+    QVERIFY2(decodeWorst < 1e-6, qPrintable(QString("decode error %1").arg(decodeWorst)));
+    QVERIFY2(encodeWorst < 1e-3, qPrintable(QString("encode error %1").arg(encodeWorst)));
+
+    for (int code=0; code < 256; code++)
+    {
+        QVERIFY(fabs(ColorTables::srgbToLinear(code) - decodeSRGB(code / 255.0)) < 1e-6);
+    }
+}
+
+// --- Linear light keeps every 8-bit code apart ---
+void TestColorTables::srgbRoundTrip()
+{
+    for (int code=0; code < 256; code++)
+    {
+        QCOMPARE(static_cast<int>(ColorTables::linearToSRGB(ColorTables::srgbToLinear(code))), code);
+    }
+}
+
+// ----- HSI ------------------------------------------------------------------
+void TestColorTables::hsiPrimaries()
+{
+    double H, S, I;
+
+    MyImage::rgbToHSI(1.0, 0.0, 0.0, H, S, I);
+    QVERIFY(fabs(H) < 1e-9 && fabs(S - 1.0) < 1e-9 && fabs(I - 1.0 / 3.0) < 1e-9);
+    MyImage::rgbToHSI(0.0, 1.0, 0.0, H, S, I);
+    QVERIFY(fabs(H - 1.0 / 3.0) < 1e-9 && fabs(S - 1.0) < 1e-9);
+    MyImage::rgbToHSI(0.0, 0.0, 1.0, H, S, I);
+    QVERIFY(fabs(H - 2.0 / 3.0) < 1e-9 && fabs(S - 1.0) < 1e-9);
+
+    // --- Gray has no hue; it is reported as zero, not as noise ---
+    MyImage::rgbToHSI(0.5, 0.5, 0.5, H, S, I);
+    QVERIFY(H == 0.0 && fabs(S) < 1e-9 && fabs(I - 0.5) < 1e-9);
+}
+
+// --- Near-grays are where a tabled sqrt or acos used to snap hue to zero ---
+void TestColorTables::hsiHueAccuracy_data()
+{
+    QTest::addColumn<double>("red");
+    QTest::addColumn<double>("green");
+    QTest::addColumn<double>("blue");
+
+    QTest::newRow("bluish gray") << 0.5 << 0.5 << 0.501;
+    QTest::newRow("warm gray") << 0.5 << 0.49 << 0.48;
+    QTest::newRow("cool gray") << 0.45 << 0.47 << 0.5;
+    QTest::newRow("dark near black") << 0.002 << 0.001 << 0.0015;
+    QTest::newRow("magenta") << 0.9 << 0.2 << 0.4;
+
+    cv::RNG random(31);
+    for (int sample=0; sample < 1000; sample++)
+    {
+        QTest::newRow(qPrintable(QString("random %1").arg(sample)))
+                << random.uniform(0.0, 1.0) << random.uniform(0.0, 1.0) << random.uniform(0.0, 1.0);
+    }
+}
+
+void TestColorTables::hsiHueAccuracy()
+{
+    QFETCH(double, red);
+    QFETCH(double, green);
+    QFETCH(double, blue);
+
+    double H, S, I;
+    MyImage::rgbToHSI(red, green, blue, H, S, I);
+
+    double expected = chromaHue(red, green, blue);
+    double error = std::min(fabs(H - expected), 1.0 - fabs(H - expected));
+    QVERIFY2(error < 1e-9, qPrintable(QString("hue %1, expected %2").arg(H).arg(expected)));
+}
+
+// --- Back and forth through HSI, limited only by the cosine table ---
+void TestColorTables::hsiRoundTrip()
+{
+    cv::RNG random(37);
+    double worst = 0.0;
+
+    for (int sample=0; sample < 100000; sample++)
+    {
+        double R = random.uniform(0.0, 1.0);
+        double G = random.uniform(0.0, 1.0);
+        double B = random.uniform(0.0, 1.0);
+
+        double H, S, I, r, g, b;
+        MyImage::rgbToHSI(R, G, B, H, S, I);
+        MyImage::hsiToRGB(H, S, I, r, g, b);
+        worst = std::max(worst, std::max(fabs(r - R), std::max(fabs(g - G), fabs(b - B))));
+    }
+    QVERIFY2(worst < 1e-5, qPrintable(QString("round trip error %1").arg(worst)));
+}
+
+QTEST_APPLESS_MAIN(TestColorTables)
+
+#include "tst_colortables.moc"
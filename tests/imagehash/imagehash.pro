@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_imagehash
+
+SOURCES += tst_imagehash.cpp
@@ -0,0 +1,150 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "imagehash.h"
+
+// --- Digests are fixed, whichever lanes compute them. ---
+// This file is built twice: as is, using SSE2 on x86, and with
+// IMAGEHASH_SCALAR for the portable lanes. Both builds check the same
+// recorded digests, so the two paths cannot drift apart. The remaining
+// tests check that a digest depends only on the bytes, not on how they are
+// fed, and that ROIs and tiles hash their pixels and nothing around them.
+class TestImageHash : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void knownDigests_data();
+    void knownDigests();
+    void chunkingIndependence();
+    void roiIgnoresPadding();
+    void tilesHashTheirPixels();
+    void shapeIsPartOfTheKey();
+
+private:
+    static std::vector<uchar> pattern(size_t length);
+};
+
+// ----- Helpers --------------------------------------------------------------
+std::vector<uchar> TestImageHash::pattern(size_t length)
+{
+    std::vector<uchar> data(length);
+    for (size_t index=0; index < length; index++)
+    {
+        data[index] = static_cast<uchar>((index * 2654435761u) >> 13);
+    }
+    return data;
+}
+
+// ----- Tests ----------------------------------------------------------------
+// --- Lengths around the 64-byte stripe and the 1 KiB scramble ---
+void TestImageHash::knownDigests_data()
+{
+    QTest::addColumn<int>("length");
+    QTest::addColumn<quint64>("unseeded");
+    QTest::addColumn<quint64>("seeded");
+
+    QTest::newRow("empty") << 0 << Q_UINT64_C(0xC72826A180A2EB4F) << Q_UINT64_C(0xBBC7EBDF661B7C55);
+    QTest::newRow("1") << 1 << Q_UINT64_C(0x1A977E80426F2FA4) << Q_UINT64_C(0x874568FFD69733C7);
+    QTest::newRow("7") << 7 << Q_UINT64_C(0xE620BEDEDFF68F2D) << Q_UINT64_C(0x566D36E6CC613234);
+    QTest::newRow("63") << 63 << Q_UINT64_C(0xEF802B245978A1B6) << Q_UINT64_C(0x68A1AACD1392E8C9);
+    QTest::newRow("64") << 64 << Q_UINT64_C(0x1D8D49FE150FB89A) << Q_UINT64_C(0xA91CEFD2FD069911);
+    QTest::newRow("65") << 65 << Q_UINT64_C(0x57AEAE1882D2BE4C) << Q_UINT64_C(0xC2E17D894F2D72DB);
+    QTest::newRow("1000") << 1000 << Q_UINT64_C(0x3D9D3A517A0875D9) << Q_UINT64_C(0xEA27ED06A2C66A96);
+    QTest::newRow("1024") << 1024 << Q_UINT64_C(0xE170417CC13A4111) << Q_UINT64_C(0xE26D738579C9DCBD);
+    QTest::newRow("1025") << 1025 << Q_UINT64_C(0x724D5DA77EF370B3) << Q_UINT64_C(0xFC0B39A656DCF1F4);
+    QTest::newRow("4099") << 4099 << Q_UINT64_C(0xCE5AB1C62909CE20) << Q_UINT64_C(0x6D1FCBA4595339EA);
+    QTest::newRow("65549") << 65549 << Q_UINT64_C(0xB45C44CE1D955A57) << Q_UINT64_C(0x70F54B1EF355CD39);
+}
+
+void TestImageHash::knownDigests()
+{
+    QFETCH(int, length);
+    QFETCH(quint64, unseeded);
+    QFETCH(quint64, seeded);
+
+    std::vector<uchar> data = pattern(length);
+    const uchar *bytes = data.empty() ? 0 : &data[0];
+    QCOMPARE(ImageHash::hash(bytes, data.size()), unseeded);
+    QCOMPARE(ImageHash::hash(bytes, data.size(), 12345), seeded);
+}
+
+void TestImageHash::chunkingIndependence()
+{
+    std::vector<uchar> data = pattern(100000);
+    quint64 expected = ImageHash::hash(&data[0], data.size(), 5);
+
+    cv::RNG random(46);
+    for (int trial=0; trial < 200; trial++)
+    {
+        ImageHash state(5);
+        size_t position = 0;
+        while (position < data.size())
+        {
+            size_t length = std::min(data.size() - position, static_cast<size_t>(random.uniform(0, 3000)));
+            state.update(&data[position], length);
+            position += length;
+        }
+        QCOMPARE(state.digest(), expected);
+    }
+}
+
+void TestImageHash::roiIgnoresPadding()
+{
+    cv::Mat image(300, 400, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    cv::Mat region = image(cv::Rect(13, 7, 250, 200));
+    QVERIFY(!region.isContinuous());
+    QCOMPARE(ImageHash::hash(region), ImageHash::hash(region.clone()));
+
+    // --- Changing a pixel just outside the ROI leaves its hash alone ---
+    quint64 before = ImageHash::hash(region);
+    image.at<cv::Vec3b>(6, 13) = image.at<cv::Vec3b>(6, 13) + cv::Vec3b(1, 1, 1);
+    image.at<cv::Vec3b>(7, 263) = image.at<cv::Vec3b>(7, 263) + cv::Vec3b(1, 1, 1);
+    QCOMPARE(ImageHash::hash(region), before);
+
+    image.at<cv::Vec3b>(7, 13)[0] ^= 1;
+    QVERIFY(ImageHash::hash(region) != before);
+}
+
+// --- Each tile hash equals the hash of that tile's packed pixels ---
+void TestImageHash::tilesHashTheirPixels()
+{
+    const int tileSize = 64;
+    cv::Mat image(300, 400, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    std::vector<quint64> hashes = ImageHash::tileHashes(image, tileSize);
+    int across = (image.cols + tileSize - 1) / tileSize;
+    int down = (image.rows + tileSize - 1) / tileSize;
+    QCOMPARE(static_cast<int>(hashes.size()), across * down);
+
+    for (int index=0; index < static_cast<int>(hashes.size()); index++)
+    {
+        int x = (index % across) * tileSize;
+        int y = (index / across) * tileSize;
+        cv::Mat tile = image(cv::Rect(x, y, std::min(tileSize, image.cols - x),
+                                      std::min(tileSize, image.rows - y))).clone();
+        QCOMPARE(hashes[index], ImageHash::hash(tile.data, tile.total() * tile.elemSize(), tileSize));
+    }
+}
+
+void TestImageHash::shapeIsPartOfTheKey()
+{
+    cv::Mat image(64, 48, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    quint64 original = ImageHash::hash(image);
+    QVERIFY(ImageHash::hash(image.reshape(3, 48)) != original);
+    QVERIFY(ImageHash::hash(image.reshape(1)) != original);
+}
+
+QTEST_APPLESS_MAIN(TestImageHash)
+
+#include "tst_imagehash.moc"
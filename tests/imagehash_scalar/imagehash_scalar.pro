@@ -0,0 +1,8 @@
+# --- The same checks against the portable lanes, so both agree on the digests ---
+include(../tests.pri)
+
+DEFINES += IMAGEHASH_SCALAR
+
+TARGET = tst_imagehash_scalar
+
+SOURCES += ../imagehash/tst_imagehash.cpp
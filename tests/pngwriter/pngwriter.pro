@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_pngwriter
+
+SOURCES += tst_pngwriter.cpp
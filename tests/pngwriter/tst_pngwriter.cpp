@@ -0,0 +1,146 @@
+#include <QtTest>
+
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include <zlib.h>
+
+#include "pngwriter.h"
+
+// --- Strips deflated apart must join into one valid zlib stream. ---
+// The IDAT payloads are concatenated and inflated by zlib itself, which
+// checks the header, the sync-flushed joins and the combined Adler-32; the
+// file is then decoded by OpenCV and compared with the input pixel for pixel.
+class TestPngWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stripsJoin_data();
+    void stripsJoin();
+    void rejectsUnsupported();
+
+private:
+    static quint32 readBigEndian(const uchar *bytes);
+    static cv::Mat testImage(int rows, int cols, int channels);
+};
+
+// ----- Helpers --------------------------------------------------------------
+quint32 TestPngWriter::readBigEndian(const uchar *bytes)
+{
+    return (quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) | (quint32(bytes[2]) << 8) | bytes[3];
+}
+
+// --- Gradients repeat across strip edges, noise keeps some rows incompressible ---
+cv::Mat TestPngWriter::testImage(int rows, int cols, int channels)
+{
+    cv::Mat image(rows, cols, CV_8UC(channels));
+    cv::RNG random(rows * 31 + cols);
+
+    for (int y=0; y < rows; y++)
+    {
+        uchar *row = image.ptr<uchar>(y);
+        bool noisy = (y / 7) % 5 == 0;
+        for (int x=0; x < cols * channels; x++)
+        {
+            row[x] = noisy ? static_cast<uchar>(random.uniform(0, 256))
+                           : static_cast<uchar>((x / channels + 3 * y + 40 * (x % channels)) & 255);
+        }
+    }
+    return image;
+}
+
+// ----- Tests ----------------------------------------------------------------
+void TestPngWriter::stripsJoin_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<int>("compression");
+    QTest::addColumn<int>("strips");
+
+    QTest::newRow("one strip") << 300 << 3 << 6 << 1;
+    QTest::newRow("two strips") << 300 << 3 << 6 << 2;
+    QTest::newRow("uneven last strip") << 301 << 3 << 6 << 7;
+    QTest::newRow("minimum strip rows") << 300 << 3 << 6 << 64;
+    QTest::newRow("stored") << 300 << 3 << 0 << 4;
+    QTest::newRow("fastest") << 300 << 3 << 1 << 4;
+    QTest::newRow("smallest") << 300 << 3 << 9 << 4;
+    QTest::newRow("gray") << 257 << 1 << 6 << 5;
+    QTest::newRow("alpha") << 257 << 4 << 6 << 5;
+    QTest::newRow("default strips") << 1000 << 3 << 3 << 0;
+}
+
+void TestPngWriter::stripsJoin()
+{
+    QFETCH(int, rows);
+    QFETCH(int, channels);
+    QFETCH(int, compression);
+    QFETCH(int, strips);
+
+    const int cols = 211;
+    cv::Mat image = testImage(rows, cols, channels);
+
+    std::vector<uchar> buffer;
+    QVERIFY(PngWriter::encode(image, buffer, compression, strips));
+
+    // --- Walk the chunks, checking every CRC and collecting IDAT payloads ---
+    QVERIFY(buffer.size() > 8);
+    std::vector<uchar> stream;
+    int dataChunks = 0;
+    size_t position = 8;
+    bool ended = false;
+
+    while (position + 12 <= buffer.size())
+    {
+        quint32 length = readBigEndian(&buffer[position]);
+        QVERIFY(position + 12 + length <= buffer.size());
+
+        const uchar *type = &buffer[position + 4];
+        quint32 stored = readBigEndian(&buffer[position + 8 + length]);
+        QCOMPARE(static_cast<quint32>(crc32(0, type, 4 + length)), stored);
+
+        if (std::memcmp(type, "IDAT", 4) == 0)
+        {
+            stream.insert(stream.end(), type + 4, type + 4 + length);
+            dataChunks++;
+        }
+        ended = std::memcmp(type, "IEND", 4) == 0;
+        position += 12 + length;
+    }
+    QVERIFY(ended);
+    QCOMPARE(static_cast<qint64>(position), static_cast<qint64>(buffer.size()));
+    if (strips == 1)
+    {
+        QCOMPARE(dataChunks, 1);
+    }
+    else if (strips > 1)
+    {
+        QVERIFY(dataChunks > 1);
+    }
+
+    // --- zlib verifies the header, the joins and the Adler-32 ---
+    uLongf inflatedBytes = static_cast<uLongf>(rows) * (cols * channels + 1);
+    std::vector<uchar> inflated(inflatedBytes + 1);
+    uLongf capacity = static_cast<uLongf>(inflated.size());
+    QCOMPARE(uncompress(&inflated[0], &capacity, &stream[0], static_cast<uLong>(stream.size())), Z_OK);
+    QCOMPARE(static_cast<qint64>(capacity), static_cast<qint64>(inflatedBytes));
+
+    cv::Mat decoded = cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+    QCOMPARE(decoded.type(), image.type());
+    QVERIFY(cv::norm(image, decoded, cv::NORM_INF) == 0.0);
+}
+
+void TestPngWriter::rejectsUnsupported()
+{
+    std::vector<uchar> buffer;
+    QVERIFY(!PngWriter::encode(cv::Mat(), buffer));
+    QVERIFY(!PngWriter::encode(cv::Mat(16, 16, CV_16UC3, cv::Scalar::all(0)), buffer));
+    QVERIFY(!PngWriter::encode(cv::Mat(16, 16, CV_8UC2, cv::Scalar::all(0)), buffer));
+}
+
+QTEST_APPLESS_MAIN(TestPngWriter)
+
+#include "tst_pngwriter.moc"
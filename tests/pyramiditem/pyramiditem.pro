@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+QT += widgets
+
+INCLUDEPATH += $$PWD/../../gui
+
+TARGET = tst_pyramiditem
+
+SOURCES += tst_pyramiditem.cpp \
+    ../../gui/pyramiditem.cpp
+
+HEADERS += ../../gui/pyramiditem.h
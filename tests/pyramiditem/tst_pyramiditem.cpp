@@ -0,0 +1,149 @@
+#include <QtTest>
+
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "pyramiditem.h"
+
+// --- A paint of a 24 MP image into a full HD viewport reads a bounded area. ---
+// Whatever the zoom, the level chosen keeps the pixels scaled per paint
+// within twice the viewport on each axis; that is what keeps a paint inside
+// a 16 ms frame, and unlike a wall-clock limit it does not depend on the
+// machine. The paint cost itself is reported by the benchmark, with the
+// first paint at each scale, which builds the level, left out.
+class TestPyramidItem : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sourceStaysBounded_data();
+    void sourceStaysBounded();
+    void paintBenchmark_data();
+    void paintBenchmark();
+    void oneToOneIsExact();
+
+private:
+    PyramidItem *item;
+    QImage source;
+    QImage viewport;
+
+    QRectF exposedRect(double scale, QPointF topLeft) const;
+    void paint(double scale, QPointF topLeft);
+};
+
+// ----- Fixture --------------------------------------------------------------
+void TestPyramidItem::initTestCase()
+{
+    source = QImage(6000, 4000, QImage::Format_RGB888);
+    for (int y=0; y < source.height(); y++)
+    {
+        uchar *row = source.scanLine(y);
+        for (int x=0; x < source.width() * 3; x++)
+        {
+            row[x] = static_cast<uchar>((x / 3 + y) ^ (x % 3 * 85));
+        }
+    }
+
+    item = new PyramidItem(source);
+    viewport = QImage(1920, 1080, QImage::Format_RGB32);
+}
+
+void TestPyramidItem::cleanupTestCase()
+{
+    delete item;
+}
+
+// ----- Helpers --------------------------------------------------------------
+// --- Image area the viewport shows at scale screen pixels per image pixel ---
+QRectF TestPyramidItem::exposedRect(double scale, QPointF topLeft) const
+{
+    return QRectF(topLeft, QSizeF(viewport.width() / scale, viewport.height() / scale));
+}
+
+void TestPyramidItem::paint(double scale, QPointF topLeft)
+{
+    QStyleOptionGraphicsItem option;
+    option.exposedRect = exposedRect(scale, topLeft);
+
+    QPainter painter(&viewport);
+    painter.scale(scale, scale);
+    painter.translate(-topLeft);
+    item->paint(&painter, &option);
+    painter.end();
+}
+
+// ----- Tests ----------------------------------------------------------------
+// --- The 6000 x 4000 source halves down to 46 x 31, level 7, the last one built ---
+void TestPyramidItem::sourceStaysBounded_data()
+{
+    QTest::addColumn<double>("scale");
+    QTest::addColumn<int>("level");
+
+    QTest::newRow("fit") << 0.25 << 2;
+    QTest::newRow("just under a third") << 0.3 << 1;
+    QTest::newRow("just over a half") << 0.51 << 0;
+    QTest::newRow("zoomed out, bilinear") << 0.7 << 0;
+    QTest::newRow("one to one") << 1.0 << 0;
+    QTest::newRow("zoomed in, bilinear") << 1.5 << 0;
+    QTest::newRow("zoomed in, nearest") << 4.0 << 0;
+    QTest::newRow("past the last level") << 0.001 << 7;
+}
+
+void TestPyramidItem::sourceStaysBounded()
+{
+    QFETCH(double, scale);
+    QFETCH(int, level);
+
+    int index = item->levelFor(scale);
+    QCOMPARE(index, level);
+
+    // --- Level pixels per screen pixel stay below two, plus the aligned edges ---
+    QRectF exposed = exposedRect(scale, QPointF(1000.0, 500.0)) & item->boundingRect();
+    QRect rect = item->sourceRect(index, exposed);
+    QVERIFY(!rect.isEmpty());
+    QVERIFY2(rect.width() <= 2 * viewport.width() + 2, qPrintable(QString::number(rect.width())));
+    QVERIFY2(rect.height() <= 2 * viewport.height() + 2, qPrintable(QString::number(rect.height())));
+}
+
+void TestPyramidItem::paintBenchmark_data()
+{
+    QTest::addColumn<double>("scale");
+
+    QTest::newRow("fit") << 0.25;
+    QTest::newRow("zoomed out, bilinear") << 0.7;
+    QTest::newRow("one to one") << 1.0;
+    QTest::newRow("zoomed in, bilinear") << 1.5;
+    QTest::newRow("zoomed in, nearest") << 4.0;
+}
+
+void TestPyramidItem::paintBenchmark()
+{
+    QFETCH(double, scale);
+
+    QPointF topLeft(1000.0, 500.0);
+    paint(scale, topLeft);
+
+    QBENCHMARK
+    {
+        paint(scale, topLeft);
+    }
+}
+
+// --- Exactly one image pixel per screen pixel copies the exposed pixels ---
+void TestPyramidItem::oneToOneIsExact()
+{
+    QPointF topLeft(2000.0, 1000.0);
+    paint(1.0, topLeft);
+
+    QImage expected = source.copy(QRect(topLeft.toPoint(), viewport.size()))
+            .convertToFormat(QImage::Format_RGB32);
+    QCOMPARE(viewport, expected);
+}
+
+QTEST_APPLESS_MAIN(TestPyramidItem)
+
+#include "tst_pyramiditem.moc"
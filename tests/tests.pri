@@ -0,0 +1,35 @@
+QT += core gui testlib
+QT -= widgets
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+include(../imaging/imaging.pri)
+
+win32 {
+    INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\build\include"
+    INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\sources\3rdparty\zlib"
+    INCLUDEPATH += "C:\OpenCV-3.2.0\opencv\sources\build\3rdparty\zlib"
+
+    LIBPATH += "C:\OpenCV-3.2.0\opencv\sources\build\lib\Release"
+    LIBPATH += "C:\OpenCV-3.2.0\opencv\sources\build\3rdparty\lib\Release"
+
+    LIBS += -lopencv_core320 \
+        -lopencv_imgproc320 \
+        -lopencv_highgui320 \
+        -lopencv_videoio320 \
+        -lopencv_imgcodecs320 \
+        -lzlib
+} else {
+    INCLUDEPATH += /opt/local/include/
+
+    LIBS += -L/opt/local/lib \
+        -lopencv_core \
+        -lopencv_imgproc \
+        -lopencv_highgui \
+        -lopencv_videoio \
+        -lopencv_imgcodecs \
+        -lz
+}
@@ -0,0 +1,11 @@
+# --- Unit checks for the pure imaging code, run with make check ---
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    colorlut3d \
+    colortables \
+    imagehash \
+    imagehash_scalar \
+    pngwriter \
+    pyramiditem \
+    tiledimagefile
@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_tiledimagefile
+
+SOURCES += tst_tiledimagefile.cpp
@@ -0,0 +1,231 @@
+#include <QtTest>
+
+#include <QByteArray>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "tiledimagefile.h"
+
+// --- Work images survive save and load bit for bit; broken ones do not open. ---
+// Round trips cover flat tiles (long LZ4 matches), gradients, noise that is
+// stored raw, partial edge tiles and every supported depth. The corrupt cases
+// patch one header or index field of a valid file each.
+class TestTiledImageFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void roundTrip_data();
+    void roundTrip();
+    void regionsAndTiles();
+    void rejectsCorruptFiles_data();
+    void rejectsCorruptFiles();
+    void rejectsUnsupportedSaves();
+
+private:
+    QTemporaryDir directory;
+
+    static cv::Mat testImage(int rows, int cols, int type, int pattern);
+};
+
+// ----- Helpers --------------------------------------------------------------
+// --- 0 flat, 1 gradient, 2 noise, 3 noise and flat in alternate tiles ---
+cv::Mat TestTiledImageFile::testImage(int rows, int cols, int type, int pattern)
+{
+    cv::Mat image(rows, cols, type, cv::Scalar::all(17));
+    cv::RNG random(rows + 7 * pattern);
+
+    if (pattern == 1)
+    {
+        cv::Mat gradient(rows, cols, CV_32FC1);
+        for (int y=0; y < rows; y++)
+        {
+            for (int x=0; x < cols; x++)
+            {
+                gradient.at<float>(y, x) = static_cast<float>((x + 2 * y) % 200);
+            }
+        }
+
+        std::vector<cv::Mat> planes(CV_MAT_CN(type));
+        for (size_t channel=0; channel < planes.size(); channel++)
+        {
+            gradient.convertTo(planes[channel], CV_MAT_DEPTH(type), 1.0, 20.0 * channel);
+        }
+        cv::merge(planes, image);
+    }
+    else if (pattern == 2)
+    {
+        random.fill(image, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(250));
+    }
+    else if (pattern == 3)
+    {
+        for (int y=0; y < rows; y += 64)
+        {
+            cv::Mat band = image.rowRange(y, std::min(rows, y + 32));
+            random.fill(band, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(250));
+        }
+    }
+    return image;
+}
+
+void TestTiledImageFile::initTestCase()
+{
+    QVERIFY(directory.isValid());
+}
+
+// ----- Round Trips ----------------------------------------------------------
+void TestTiledImageFile::roundTrip_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<int>("pattern");
+    QTest::addColumn<int>("codec");
+    QTest::addColumn<int>("tileSize");
+
+    QTest::newRow("flat lz4") << CV_8UC3 << 0 << int(TiledImageFile::LZ4Codec) << 256;
+    QTest::newRow("gradient lz4") << CV_8UC3 << 1 << int(TiledImageFile::LZ4Codec) << 256;
+    QTest::newRow("noise lz4") << CV_8UC3 << 2 << int(TiledImageFile::LZ4Codec) << 256;
+    QTest::newRow("mixed lz4") << CV_8UC3 << 3 << int(TiledImageFile::LZ4Codec) << 100;
+    QTest::newRow("gradient raw") << CV_8UC3 << 1 << int(TiledImageFile::RawCodec) << 256;
+    QTest::newRow("gray") << CV_8UC1 << 3 << int(TiledImageFile::LZ4Codec) << 64;
+    QTest::newRow("alpha") << CV_8UC4 << 3 << int(TiledImageFile::LZ4Codec) << 128;
+    QTest::newRow("16-bit") << CV_16UC3 << 1 << int(TiledImageFile::LZ4Codec) << 256;
+    QTest::newRow("float") << CV_32FC1 << 3 << int(TiledImageFile::LZ4Codec) << 256;
+}
+
+void TestTiledImageFile::roundTrip()
+{
+    QFETCH(int, type);
+    QFETCH(int, pattern);
+    QFETCH(int, codec);
+    QFETCH(int, tileSize);
+
+    cv::Mat image = testImage(300, 515, type, pattern);
+    QString path = directory.filePath(QString("round%1.ict").arg(QTest::currentDataTag()));
+
+    QString error;
+    QVERIFY2(TiledImageFile::save(path, image, TiledImageFile::Codec(codec), tileSize, &error),
+             qPrintable(error));
+
+    cv::Mat loaded;
+    QVERIFY2(TiledImageFile::load(path, loaded, &error), qPrintable(error));
+    QCOMPARE(loaded.type(), image.type());
+    QCOMPARE(loaded.rows, image.rows);
+    QCOMPARE(loaded.cols, image.cols);
+    QVERIFY(cv::norm(image, loaded, cv::NORM_INF) == 0.0);
+}
+
+// --- Partial reads decode only what they touch and match the whole image ---
+void TestTiledImageFile::regionsAndTiles()
+{
+    cv::Mat image = testImage(300, 515, CV_8UC3, 3);
+    QString path = directory.filePath("regions.ict");
+    QVERIFY(TiledImageFile::save(path, image, TiledImageFile::LZ4Codec, 128));
+
+    TiledImageFile tiledFile;
+    QVERIFY(tiledFile.open(path));
+    QCOMPARE(tiledFile.tilesAcross(), 5);
+    QCOMPARE(tiledFile.tilesDown(), 3);
+    QCOMPARE(tiledFile.channelOrder(), QString("BGR"));
+
+    cv::Mat tile;
+    QVERIFY(tiledFile.readTile(4, 2, tile));
+    QCOMPARE(tile.cols, 515 - 4 * 128);
+    QCOMPARE(tile.rows, 300 - 2 * 128);
+    QVERIFY(cv::norm(image(tiledFile.tileRect(4, 2)), tile, cv::NORM_INF) == 0.0);
+    QVERIFY(!tiledFile.readTile(5, 0, tile));
+
+    cv::Rect regions[] = { cv::Rect(0, 0, 515, 300), cv::Rect(100, 50, 300, 200),
+                           cv::Rect(128, 128, 128, 128), cv::Rect(510, 295, 20, 20) };
+    for (int index=0; index < 4; index++)
+    {
+        cv::Mat region;
+        QVERIFY(tiledFile.readRegion(regions[index], region));
+        cv::Rect clipped = regions[index] & cv::Rect(0, 0, 515, 300);
+        QVERIFY(cv::norm(image(clipped), region, cv::NORM_INF) == 0.0);
+    }
+}
+
+// ----- Corrupt Files --------------------------------------------------------
+// --- Byte offset and little-endian 32-bit value written over a valid file ---
+void TestTiledImageFile::rejectsCorruptFiles_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<int>("truncate");
+
+    QTest::newRow("unchanged") << -1 << qint64(0) << 0;
+    QTest::newRow("truncated header") << -1 << qint64(0) << 40;
+    QTest::newRow("truncated index") << -1 << qint64(0) << 60;
+    QTest::newRow("zero width") << 8 << qint64(0) << 0;
+    QTest::newRow("huge width") << 8 << qint64(1 << 30) << 0;
+    QTest::newRow("huge height") << 12 << qint64(0xFFFFFFFFLL) << 0;
+    QTest::newRow("double type") << 16 << qint64(CV_64FC3) << 0;
+    QTest::newRow("two channels") << 16 << qint64(CV_8UC2) << 0;
+    QTest::newRow("type flags") << 16 << qint64(CV_8UC3 | 0x4000) << 0;
+    QTest::newRow("zero tile size") << 24 << qint64(0) << 0;
+    QTest::newRow("huge tile size") << 24 << qint64(1 << 20) << 0;
+    QTest::newRow("tile count") << 32 << qint64(7) << 0;
+    QTest::newRow("tile past end") << 48 << qint64(1 << 30) << 0;
+    QTest::newRow("stored larger than raw") << 56 << qint64(0xFFFFFFFFLL) << 0;
+    QTest::newRow("expands too far") << 56 << qint64(1) << 0;
+    QTest::newRow("wrong raw size") << 60 << qint64(1) << 0;
+}
+
+void TestTiledImageFile::rejectsCorruptFiles()
+{
+    QFETCH(int, offset);
+    QFETCH(qint64, value);
+    QFETCH(int, truncate);
+
+    // --- Flat 256x256 tiles, so the first one is a short LZ4 block ---
+    cv::Mat image = testImage(300, 515, CV_8UC3, 0);
+    QString path = directory.filePath("valid.ict");
+    QVERIFY(TiledImageFile::save(path, image, TiledImageFile::LZ4Codec, 256));
+
+    QFile source(path);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    QByteArray bytes = source.readAll();
+    source.close();
+
+    if (offset >= 0)
+    {
+        qToLittleEndian<quint32>(static_cast<quint32>(value), reinterpret_cast<uchar*>(bytes.data()) + offset);
+    }
+    if (truncate > 0)
+    {
+        bytes.truncate(truncate);
+    }
+
+    QString corruptPath = directory.filePath("corrupt.ict");
+    QFile corrupt(corruptPath);
+    QVERIFY(corrupt.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QCOMPARE(corrupt.write(bytes), static_cast<qint64>(bytes.size()));
+    corrupt.close();
+
+    TiledImageFile tiledFile;
+    QString error;
+    bool valid = offset < 0 && truncate == 0;
+    QCOMPARE(tiledFile.open(corruptPath, &error), valid);
+    QCOMPARE(error.isEmpty(), valid);
+    QCOMPARE(tiledFile.isOpen(), valid);
+}
+
+void TestTiledImageFile::rejectsUnsupportedSaves()
+{
+    QString path = directory.filePath("unsupported.ict");
+    QVERIFY(!TiledImageFile::save(path, cv::Mat(16, 16, CV_64FC3, cv::Scalar::all(0))));
+    QVERIFY(!TiledImageFile::save(path, cv::Mat(16, 16, CV_8UC2, cv::Scalar::all(0))));
+    QVERIFY(!TiledImageFile::save(path, cv::Mat(16, 16, CV_8UC3, cv::Scalar::all(0)),
+                                  TiledImageFile::LZ4Codec, TiledImageFile::maximumTileSize + 1));
+}
+
+QTEST_APPLESS_MAIN(TestTiledImageFile)
+
+#include "tst_tiledimagefile.moc"